@@ -18,19 +18,34 @@
 #include <flatbuffers/flexbuffers.h>
 
 #include <atomic>
+#include <functional>
 
 #include "AittException.h"
 #include "aitt_internal.h"
 
 namespace aitt {
 
-AittDiscovery::AittDiscovery(const std::string &id) : id_(id), callback_handle(nullptr)
+AittDiscovery::AittDiscovery(const std::string &id)
+      : id_(id), discovery_mq(nullptr), callback_handle(nullptr)
 {
 }
 
+AittDiscovery::~AittDiscovery()
+{
+    if (own_mq)
+        own_mq->SetConnectionCallback(nullptr);
+}
+
 void AittDiscovery::SetMQ(std::unique_ptr<MQ> mq)
 {
-    discovery_mq = std::move(mq);
+    own_mq = std::move(mq);
+    discovery_mq = own_mq.get();
+}
+
+void AittDiscovery::SetSharedMQ(MQ *mq)
+{
+    own_mq.reset();
+    discovery_mq = mq;
 }
 
 void AittDiscovery::Start(const std::string &host, int port, const std::string &username,
@@ -38,8 +53,13 @@ void AittDiscovery::Start(const std::string &host, int port, const std::string &
 {
     RET_IF(callback_handle);
 
+    // The will tells the others when the connection is lost, through the retained topic
     discovery_mq->SetWillInfo(DISCOVERY_TOPIC_BASE + id_, nullptr, 0, AITT_QOS_EXACTLY_ONCE, true);
-    discovery_mq->Connect(host, port, username, password);
+    if (own_mq) {
+        own_mq->SetConnectionCallback(
+              std::bind(&AittDiscovery::ConnectionCallback, this, std::placeholders::_1));
+        own_mq->Connect(host, port, username, password);
+    }
 
     callback_handle = discovery_mq->Subscribe(DISCOVERY_TOPIC_BASE + "+", DiscoveryMessageCallback,
           static_cast<void *>(this), AITT_QOS_EXACTLY_ONCE);
@@ -47,15 +67,37 @@ void AittDiscovery::Start(const std::string &host, int port, const std::string &
 
 void AittDiscovery::Stop()
 {
+    if (own_mq)
+        own_mq->SetConnectionCallback(nullptr);
     discovery_mq->Unsubscribe(callback_handle);
     discovery_mq->Publish(DISCOVERY_TOPIC_BASE + id_, nullptr, 0, AITT_QOS_EXACTLY_ONCE, true);
     discovery_mq->Publish(DISCOVERY_TOPIC_BASE + id_, nullptr, 0, AITT_QOS_AT_MOST_ONCE, true);
     callback_handle = nullptr;
-    discovery_mq->Disconnect();
+    if (own_mq)
+        own_mq->Disconnect();
+}
+
+// The will of a lost connection has removed the discovery message from the broker
+void AittDiscovery::ConnectionCallback(int status)
+{
+    if (status != AITT_CONNECTED)
+        return;
+
+    std::lock_guard<std::mutex> lock(discovery_map_lock);
+    if (discovery_map.empty())
+        return;
+
+    // Exceptions must not reach the network thread calling this
+    try {
+        PublishDiscoveryMsg();
+    } catch (std::exception &e) {
+        ERR("PublishDiscoveryMsg() Fail(%s)", e.what());
+    }
 }
 
 void AittDiscovery::UpdateDiscoveryMsg(AittProtocol protocol, const void *msg, size_t length)
 {
+    std::lock_guard<std::mutex> lock(discovery_map_lock);
     auto it = discovery_map.find(protocol);
     if (it == discovery_map.end())
         discovery_map.emplace(protocol, DiscoveryBlob(msg, length));
@@ -17,6 +17,7 @@
 
 #include <map>
 #include <memory>
+#include <mutex>
 
 #include "MQ.h"
 
@@ -32,7 +33,12 @@ class AittDiscovery {
 
     // AittDiscovery() = default;
     explicit AittDiscovery(const std::string &id);
+    ~AittDiscovery();
     void SetMQ(std::unique_ptr<MQ> mq);
+    // Runs over a connection owned by the caller, which connects and disconnects it and passes
+    // its connection state to ConnectionCallback()
+    void SetSharedMQ(MQ *mq);
+    void ConnectionCallback(int status);
     void Start(const std::string &host, int port, const std::string &username,
           const std::string &password);
     void Stop();
@@ -58,9 +64,11 @@ class AittDiscovery {
     AittProtocol GetProtocol(const std::string &protocol_str);
 
     std::string id_;
-    std::unique_ptr<MQ> discovery_mq;
+    std::unique_ptr<MQ> own_mq;  // nullptr with SetSharedMQ()
+    MQ *discovery_mq;
     void *callback_handle;
     std::map<AittProtocol, DiscoveryBlob> discovery_map;
+    std::mutex discovery_map_lock;
     std::map<int, std::pair<AittProtocol, DiscoveryCallback>> callbacks;
 };
 
@@ -47,6 +47,10 @@ std::string AittException::getErrString() const
         return "MQTT failure";
     case NO_DATA_ERR:
         return "No data found";
+    case TIMED_OUT_ERR:
+        return "Timed out";
+    case WOULD_BLOCK_ERR:
+        return "Would block";
     default:
         return "Unknown Error";
     }
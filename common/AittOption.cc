@@ -17,12 +17,31 @@
 
 #include "aitt_internal.h"
 
-AittOption::AittOption() : clear_session_(false), use_custom_broker(false)
+AittOption::AittOption()
+      : clear_session_(false),
+        use_custom_broker(false),
+        callback_threads(1),
+        multiplex_reply(false),
+        legacy_reply_format(false),
+        max_inflight(0),
+        max_queued(0),
+        mq_connections(1),
+        shared_discovery(false),
+        tcp_reactor_threads(1)
 {
 }
 
 AittOption::AittOption(bool clear_session, bool use_custom_mqtt_broker)
-      : clear_session_(clear_session), use_custom_broker(use_custom_mqtt_broker)
+      : clear_session_(clear_session),
+        use_custom_broker(use_custom_mqtt_broker),
+        callback_threads(1),
+        multiplex_reply(false),
+        legacy_reply_format(false),
+        max_inflight(0),
+        max_queued(0),
+        mq_connections(1),
+        shared_discovery(false),
+        tcp_reactor_threads(1)
 {
 }
 
@@ -89,3 +108,88 @@ const char* AittOption::GetCustomRWFile() const
 {
     return custom_rw_file.c_str();
 }
+
+void AittOption::SetCallbackThreads(int count)
+{
+    RET_IF(count < 1);
+    callback_threads = count;
+}
+
+int AittOption::GetCallbackThreads() const
+{
+    return callback_threads;
+}
+
+void AittOption::SetMultiplexReply(bool val)
+{
+    multiplex_reply = val;
+}
+
+bool AittOption::GetMultiplexReply() const
+{
+    return multiplex_reply;
+}
+
+void AittOption::SetLegacyReplyFormat(bool val)
+{
+    legacy_reply_format = val;
+}
+
+bool AittOption::GetLegacyReplyFormat() const
+{
+    return legacy_reply_format;
+}
+
+void AittOption::SetMaxInflight(int count)
+{
+    RET_IF(count < 0);
+    max_inflight = count;
+}
+
+int AittOption::GetMaxInflight() const
+{
+    return max_inflight;
+}
+
+void AittOption::SetMaxQueued(int count)
+{
+    RET_IF(count < 0);
+    max_queued = count;
+}
+
+int AittOption::GetMaxQueued() const
+{
+    return max_queued;
+}
+
+void AittOption::SetMQConnections(int count)
+{
+    RET_IF(count < 1);
+    mq_connections = count;
+}
+
+int AittOption::GetMQConnections() const
+{
+    return mq_connections;
+}
+
+void AittOption::SetSharedDiscovery(bool val)
+{
+    shared_discovery = val;
+}
+
+bool AittOption::GetSharedDiscovery() const
+{
+    return shared_discovery;
+}
+
+void AittOption::SetTCPReactorThreads(int count)
+{
+    RET_IF(count < 1);
+    tcp_reactor_threads = count;
+}
+
+int AittOption::GetTCPReactorThreads() const
+{
+    return tcp_reactor_threads;
+}
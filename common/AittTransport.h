@@ -16,10 +16,12 @@
 #pragma once
 
 #include <AittDiscovery.h>
+#include <AittOption.h>
 #include <AittTypes.h>
 
 #include <functional>
 #include <string>
+#include <vector>
 
 #define AITT_TRANSPORT_NEW aitt_transport_new
 #define TO_STR(s) #s
@@ -29,8 +31,8 @@ namespace aitt {
 
 class AittTransport {
   public:
-    typedef void *(
-          *ModuleEntry)(AittProtocol type, AittDiscovery &discovery, const std::string &my_ip);
+    typedef void *(*ModuleEntry)(AittProtocol type, AittDiscovery &discovery,
+          const std::string &my_ip, const AittOption &option);
     using SubscribeCallback = std::function<void(const std::string &topic, const void *msg,
           const size_t szmsg, void *cbdata, const std::string &correlation)>;
 
@@ -49,6 +51,13 @@ class AittTransport {
     virtual void Publish(const std::string &topic, const void *data, const size_t datalen,
           AittQoS qos = AITT_QOS_AT_MOST_ONCE, bool retain = false) = 0;
 
+    // The default implementation publishes the entries one by one
+    virtual void PublishBatch(const std::vector<AittPublishEntry> &entries)
+    {
+        for (const AittPublishEntry &entry : entries)
+            Publish(entry.topic, entry.data, entry.datalen, entry.qos);
+    }
+
     virtual void *Subscribe(const std::string &topic, const SubscribeCallback &cb,
           void *cbdata = nullptr, AittQoS qos = AITT_QOS_AT_MOST_ONCE) = 0;
     virtual void *Subscribe(const std::string &topic, const SubscribeCallback &cb, const void *data,
@@ -16,6 +16,7 @@
 #include "AittUtil.h"
 
 #include <mosquitto.h>
+#include <string.h>
 
 #include "AittException.h"
 #include "aitt_internal.h"
@@ -31,3 +32,73 @@ bool aitt::AittUtil::CompareTopic(const std::string& left, const std::string& ri
     }
     return result;
 }
+
+aitt::AittUtil::TopicFilter::TopicFilter(const std::string& in_filter)
+      : filter(in_filter), valid(true)
+{
+    int ret = mosquitto_sub_topic_check(filter.c_str());
+    if (ret != MOSQ_ERR_SUCCESS) {
+        ERR("mosquitto_sub_topic_check(%s) Fail(%s)", filter.c_str(), mosquitto_strerror(ret));
+        valid = false;
+        return;
+    }
+
+    if (filter.find_first_of("+#") == std::string::npos)
+        return;
+
+    size_t pos = 0;
+    while (true) {
+        size_t end = filter.find('/', pos);
+        Level level;
+        level.name = filter.substr(pos, end == std::string::npos ? end : end - pos);
+        if (level.name == "+")
+            level.type = Level::SINGLE;
+        else if (level.name == "#")
+            level.type = Level::MULTI;
+        else
+            level.type = Level::NAME;
+        levels.push_back(std::move(level));
+
+        if (end == std::string::npos)
+            break;
+        pos = end + 1;
+    }
+}
+
+bool aitt::AittUtil::TopicFilter::Match(const std::string& topic) const
+{
+    return Match(topic.data(), topic.size());
+}
+
+bool aitt::AittUtil::TopicFilter::Match(const char* topic, size_t length) const
+{
+    if (levels.empty())
+        return valid && length == filter.size() && filter.compare(0, length, topic, length) == 0;
+
+    // Wildcards at the first level do not match topics starting with '$'
+    if (length == 0 || (topic[0] == '$' && levels[0].type != Level::NAME))
+        return false;
+
+    // level_begin is the next topic level, or nullptr when all levels are consumed
+    const char* level_begin = topic;
+    const char* topic_end = topic + length;
+    for (const Level& level : levels) {
+        // "a/#" also matches "a"
+        if (level.type == Level::MULTI)
+            return true;
+        if (level_begin == nullptr)
+            return false;
+
+        const char* end =
+              static_cast<const char*>(memchr(level_begin, '/', topic_end - level_begin));
+        size_t level_length = (end ? end : topic_end) - level_begin;
+        if (level.type == Level::NAME
+              && (level_length != level.name.size()
+                    || memcmp(level_begin, level.name.data(), level_length) != 0))
+            return false;
+
+        level_begin = end ? end + 1 : nullptr;
+    }
+
+    return level_begin == nullptr;
+}
@@ -0,0 +1,162 @@
+/*
+ * Copyright (c) 2022 Samsung Electronics Co., Ltd All Rights Reserved
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <deque>
+#include <mutex>
+#include <stdexcept>
+
+#include "RingBuffer.h"
+#include "aitt_internal.h"
+
+namespace aitt {
+
+// Hands items over from any thread to the thread owning the event loop.
+// Items go to a RingBuffer and the consumer is woken up through an eventfd only when it is not
+// already pending, so a burst of items costs a single wakeup and is drained in one batch.
+// When the ring is full, items are kept in a locked overflow list instead of blocking the
+// producer; items of the same producer are always drained in the order they were pushed.
+// Items still queued are destroyed along with the queue, so they should own their resources.
+template <typename T>
+class EventQueue {
+  public:
+    explicit EventQueue(size_t capacity = 1024);
+    ~EventQueue(void);
+
+    // eventfd to be watched by the consumer's event loop
+    int GetHandle(void) const { return event_fd; }
+    void Push(T &&item);
+    // Calls func(T &) for queued items, up to about max_items. If it stops early, the wakeup
+    // is raised again so that other event sources get a chance to run in between.
+    template <typename Func>
+    size_t Drain(Func func, size_t max_items);
+
+    // Drain() in steps, for a consumer serving several queues in one dispatch: Acknowledge() the
+    // wakeup, Pop() as often as needed, and Wakeup() again if items may be left.
+    void Acknowledge(void);
+    template <typename Func>
+    size_t Pop(Func func, size_t max_items);
+    void Wakeup(void);
+
+  private:
+    RingBuffer<T> ring;
+    std::mutex overflow_lock;
+    std::deque<T> overflow;
+    std::deque<T> overflow_batch;  // taken from overflow by Pop(), consumer thread only
+    std::atomic<bool> overflowed;
+    std::atomic<bool> wakeup_pending;
+    int event_fd;
+};
+
+template <typename T>
+EventQueue<T>::EventQueue(size_t capacity)
+      : ring(capacity), overflowed(false), wakeup_pending(false)
+{
+    event_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (event_fd < 0)
+        throw std::runtime_error("eventfd() Fail");
+}
+
+template <typename T>
+EventQueue<T>::~EventQueue(void)
+{
+    close(event_fd);
+}
+
+template <typename T>
+void EventQueue<T>::Push(T &&item)
+{
+    if (overflowed.load(std::memory_order_acquire) || ring.Push(std::move(item)) == false) {
+        std::lock_guard<std::mutex> lock(overflow_lock);
+        overflow.push_back(std::move(item));
+        overflowed.store(true, std::memory_order_release);
+    }
+
+    Wakeup();
+}
+
+template <typename T>
+void EventQueue<T>::Wakeup(void)
+{
+    if (wakeup_pending.exchange(true, std::memory_order_acq_rel))
+        return;
+
+    uint64_t value = 1;
+    if (write(event_fd, &value, sizeof(value)) < 0 && errno != EAGAIN)
+        ERR_CODE(errno, "write(%d) Fail", event_fd);
+}
+
+template <typename T>
+template <typename Func>
+size_t EventQueue<T>::Drain(Func func, size_t max_items)
+{
+    Acknowledge();
+
+    size_t count = Pop(func, max_items);
+    if (count >= max_items)
+        Wakeup();
+
+    return count;
+}
+
+template <typename T>
+void EventQueue<T>::Acknowledge(void)
+{
+    uint64_t value;
+    if (read(event_fd, &value, sizeof(value)) < 0 && errno != EAGAIN)
+        ERR_CODE(errno, "read(%d) Fail", event_fd);
+    // Cleared before popping, so an item pushed from now on raises a new wakeup
+    wakeup_pending.exchange(false, std::memory_order_acq_rel);
+}
+
+template <typename T>
+template <typename Func>
+size_t EventQueue<T>::Pop(Func func, size_t max_items)
+{
+    size_t count = 0;
+    T item;
+    while (count < max_items) {
+        // Items pushed since the batch was taken went to the ring, so they are newer
+        if (overflow_batch.empty() == false) {
+            func(overflow_batch.front());
+            overflow_batch.pop_front();
+            count++;
+            continue;
+        }
+
+        if (ring.Pop(item)) {
+            func(item);
+            count++;
+            continue;
+        }
+
+        // The ring is empty. Items in the overflow list are newer than anything popped so far
+        if (overflowed.load(std::memory_order_acquire) == false)
+            break;
+
+        std::lock_guard<std::mutex> lock(overflow_lock);
+        overflow_batch.swap(overflow);
+        overflowed.store(false, std::memory_order_release);
+    }
+
+    return count;
+}
+
+}  // namespace aitt
@@ -0,0 +1,213 @@
+/*
+ * Copyright (c) 2022 Samsung Electronics Co., Ltd All Rights Reserved
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "GlibMainLoop.h"
+
+#include <glib.h>
+
+#include "aitt_internal.h"
+
+namespace aitt {
+
+static gboolean IdleSourceDispatch(GSource *source, GSourceFunc cb, gpointer user_data)
+{
+    // Not ready again until the next AddIdle() on an empty queue
+    g_source_set_ready_time(source, -1);
+
+    return cb ? cb(user_data) : G_SOURCE_CONTINUE;
+}
+
+// Dispatched only by its ready time, set by AddIdle()
+static GSourceFuncs idle_source_funcs = {nullptr, nullptr, IdleSourceDispatch, nullptr};
+
+GlibMainLoop::GlibMainLoop()
+{
+    GMainContext *ctx = g_main_context_new();
+    if (ctx == nullptr)
+        throw std::runtime_error("Failed to create a context");
+
+    loop = g_main_loop_new(ctx, FALSE);
+    if (loop == nullptr) {
+        g_main_context_unref(ctx);
+        throw std::runtime_error("Failed to create a loop");
+    }
+    g_main_context_unref(ctx);
+
+    idle_source = g_source_new(&idle_source_funcs, sizeof(GSource));
+    g_source_set_priority(idle_source, G_PRIORITY_HIGH);
+    g_source_set_callback(idle_source, IdlesHandler, this, nullptr);
+    g_source_attach(idle_source, ctx);
+}
+
+GlibMainLoop::~GlibMainLoop()
+{
+    g_source_destroy(idle_source);
+    g_source_unref(idle_source);
+    g_main_loop_unref(loop);
+}
+
+void GlibMainLoop::Run()
+{
+    g_main_loop_run(loop);
+}
+
+bool GlibMainLoop::Quit()
+{
+    if (g_main_loop_is_running(loop) == FALSE) {
+        ERR("main loop is not running");
+        return false;
+    }
+
+    g_main_loop_quit(loop);
+    return true;
+}
+
+void GlibMainLoop::AddWatch(int fd, const mainLoopCB &cb, MainLoopData *user_data)
+{
+    MainLoopCbData *cb_data = new MainLoopCbData();
+    GMainContext *ctx = g_main_loop_get_context(loop);
+    cb_data->ctx = ctx;
+    cb_data->cb = cb;
+    cb_data->data = user_data;
+    cb_data->fd = fd;
+
+    GIOChannel *channel = g_io_channel_unix_new(fd);
+    GSource *source = g_io_create_watch(channel, (GIOCondition)(G_IO_IN | G_IO_HUP | G_IO_ERR));
+    g_source_set_callback(source, (GSourceFunc)EventHandler, cb_data, DestroyNotify);
+
+    g_source_attach(source, ctx);
+
+    g_source_unref(source);
+
+    callback_table_lock.lock();
+    callback_table.insert(CallbackMap::value_type(fd, std::make_pair(source, cb_data)));
+    callback_table_lock.unlock();
+}
+
+MainLoopIface::MainLoopData *GlibMainLoop::RemoveWatch(int fd)
+{
+    GSource *source;
+    MainLoopData *user_data = nullptr;
+
+    {
+        std::lock_guard<std::mutex> autoLock(callback_table_lock);
+        auto it = callback_table.find(fd);
+        if (it == callback_table.end())
+            return user_data;
+        source = it->second.first;
+        user_data = it->second.second->data;
+        callback_table.erase(it);
+    }
+
+    g_source_destroy(source);
+    return user_data;
+}
+
+unsigned int GlibMainLoop::AddTimeout(int interval, const mainLoopCB &cb, MainLoopData *data)
+{
+    MainLoopCbData *cb_data = new MainLoopCbData();
+    GMainContext *ctx = g_main_loop_get_context(loop);
+    cb_data->ctx = ctx;
+    cb_data->cb = cb;
+    cb_data->data = data;
+
+    GSource *source = g_timeout_source_new(interval);
+    g_source_set_callback(source, IdlerHandler, cb_data, DestroyNotify);
+    unsigned int id = g_source_attach(source, cb_data->ctx);
+    g_source_unref(source);
+
+    return id;
+}
+
+void GlibMainLoop::RemoveTimeout(unsigned int id)
+{
+    GSource *source;
+    source = g_main_context_find_source_by_id(g_main_loop_get_context(loop), id);
+    if (source)
+        g_source_destroy(source);
+}
+
+void GlibMainLoop::AddIdle(const mainLoopCB &cb, MainLoopData *user_data)
+{
+    bool wakeup;
+    {
+        std::lock_guard<std::mutex> lock(idles_lock);
+        // The source is already ready for the idles queued before
+        wakeup = idles.empty();
+        idles.emplace_back(cb, user_data);
+    }
+
+    // Thread safe, and wakes up the context
+    if (wakeup)
+        g_source_set_ready_time(idle_source, 0);
+}
+
+gboolean GlibMainLoop::IdlesHandler(gpointer user_data)
+{
+    GlibMainLoop *main_loop = static_cast<GlibMainLoop *>(user_data);
+
+    // Idles added by the callbacks are run in the next dispatch
+    std::vector<Idle> pending;
+    {
+        std::lock_guard<std::mutex> lock(main_loop->idles_lock);
+        pending.swap(main_loop->idles);
+    }
+
+    for (Idle &idle : pending)
+        idle.first(OK, -1, idle.second);
+
+    return G_SOURCE_CONTINUE;
+}
+
+gboolean GlibMainLoop::IdlerHandler(gpointer user_data)
+{
+    RETV_IF(user_data == nullptr, FALSE);
+
+    MainLoopCbData *cb_data = static_cast<MainLoopCbData *>(user_data);
+
+    cb_data->cb(cb_data->result, cb_data->fd, cb_data->data);
+
+    return FALSE;
+}
+
+gboolean GlibMainLoop::EventHandler(GIOChannel *src, GIOCondition condition, gpointer user_data)
+{
+    RETV_IF(user_data == nullptr, FALSE);
+
+    int ret = TRUE;
+    MainLoopCbData *cb_data = static_cast<MainLoopCbData *>(user_data);
+
+    if ((G_IO_HUP | G_IO_ERR) & condition) {
+        ERR("Connection Error(%d)", condition);
+        cb_data->result = (G_IO_HUP & condition) ? HANGUP : ERROR;
+        ret = FALSE;
+    }
+
+    cb_data->cb(cb_data->result, cb_data->fd, cb_data->data);
+
+    return ret;
+}
+
+void GlibMainLoop::DestroyNotify(gpointer data)
+{
+    MainLoopCbData *cb_data = static_cast<MainLoopCbData *>(data);
+    delete cb_data;
+}
+
+GlibMainLoop::MainLoopCbData::MainLoopCbData() : data(nullptr), result(OK), fd(-1), ctx(nullptr)
+{
+}
+
+}  // namespace aitt
@@ -16,7 +16,12 @@
 #include "MSG.h"
 
 namespace aitt {
-MSG::MSG() : sequence(0), end_sequence(true), id_(nullptr), protocols_(AITT_TYPE_MQTT)
+MSG::MSG()
+      : sequence(0),
+        end_sequence(true),
+        id_(nullptr),
+        protocols_(AITT_TYPE_MQTT),
+        reply_header_accepted(false)
 {
 }
 
@@ -95,4 +100,14 @@ AittProtocol MSG::GetProtocols()
     return protocols_;
 }
 
+void MSG::SetReplyHeaderAccepted(bool accepted)
+{
+    reply_header_accepted = accepted;
+}
+
+bool MSG::IsReplyHeaderAccepted()
+{
+    return reply_header_accepted;
+}
+
 }  // namespace aitt
@@ -15,173 +15,155 @@
  */
 #include "MainLoopHandler.h"
 
-#include <glib.h>
+#include <chrono>
+#include <vector>
 
+#include "GlibMainLoop.h"
+#include "PosixMainLoop.h"
 #include "aitt_internal.h"
 
 namespace aitt {
 
-MainLoopHandler::MainLoopHandler()
+MainLoopHandler::MainLoopHandler(Backend backend)
+      : timers(Now()), tick_id(0), tick_time(TimerWheel<Timer>::NEVER), tick_serial(0)
 {
-    GMainContext *ctx = g_main_context_new();
-    if (ctx == nullptr)
-        throw std::runtime_error("Failed to create a context");
-
-    loop = g_main_loop_new(ctx, FALSE);
-    if (loop == nullptr) {
-        g_main_context_unref(ctx);
-        throw std::runtime_error("Failed to create a loop");
+    if (backend == DEFAULT_BACKEND) {
+#ifdef POSIX_MAINLOOP
+        backend = POSIX_BACKEND;
+#else
+        backend = GLIB_BACKEND;
+#endif
     }
-    g_main_context_unref(ctx);
+
+    if (backend == POSIX_BACKEND)
+        loop = std::unique_ptr<MainLoopIface>(new PosixMainLoop());
+    else
+        loop = std::unique_ptr<MainLoopIface>(new GlibMainLoop());
 }
 
-MainLoopHandler::~MainLoopHandler()
+void MainLoopHandler::AddIdle(MainLoopHandler *handle, const mainLoopCB &cb,
+      MainLoopData *user_data)
 {
-    g_main_loop_unref(loop);
+    RET_IF(handle == nullptr);
+
+    handle->AddIdle(cb, user_data);
 }
 
 void MainLoopHandler::Run()
 {
-    g_main_loop_run(loop);
+    loop->Run();
 }
 
 bool MainLoopHandler::Quit()
 {
-    if (g_main_loop_is_running(loop) == FALSE) {
-        ERR("main loop is not running");
-        return false;
-    }
+    return loop->Quit();
+}
 
-    g_main_loop_quit(loop);
-    return true;
+void MainLoopHandler::AddIdle(const mainLoopCB &cb, MainLoopData *user_data)
+{
+    loop->AddIdle(cb, user_data);
 }
 
 void MainLoopHandler::AddWatch(int fd, const mainLoopCB &cb, MainLoopData *user_data)
 {
-    MainLoopCbData *cb_data = new MainLoopCbData();
-    GMainContext *ctx = g_main_loop_get_context(loop);
-    cb_data->ctx = ctx;
-    cb_data->cb = cb;
-    cb_data->data = user_data;
-    cb_data->fd = fd;
-
-    GIOChannel *channel = g_io_channel_unix_new(fd);
-    GSource *source = g_io_create_watch(channel, (GIOCondition)(G_IO_IN | G_IO_HUP | G_IO_ERR));
-    g_source_set_callback(source, (GSourceFunc)EventHandler, cb_data, DestroyNotify);
-
-    g_source_attach(source, ctx);
-
-    g_source_unref(source);
-
-    callback_table_lock.lock();
-    callback_table.insert(CallbackMap::value_type(fd, std::make_pair(source, cb_data)));
-    callback_table_lock.unlock();
+    loop->AddWatch(fd, cb, user_data);
 }
 
-MainLoopHandler::MainLoopData *MainLoopHandler::RemoveWatch(int fd)
+MainLoopIface::MainLoopData *MainLoopHandler::RemoveWatch(int fd)
 {
-    GSource *source;
-    MainLoopData *user_data = nullptr;
-
-    {
-        std::lock_guard<std::mutex> autoLock(callback_table_lock);
-        auto it = callback_table.find(fd);
-        if (it == callback_table.end())
-            return user_data;
-        source = it->second.first;
-        user_data = it->second.second->data;
-        callback_table.erase(it);
-    }
-
-    g_source_destroy(source);
-    return user_data;
+    return loop->RemoveWatch(fd);
 }
 
-unsigned int MainLoopHandler::AddTimeout(int interval, const mainLoopCB &cb, MainLoopData *data)
+unsigned int MainLoopHandler::AddTimeout(int interval, const mainLoopCB &cb,
+      MainLoopData *user_data)
 {
-    MainLoopCbData *cb_data = new MainLoopCbData();
-    GMainContext *ctx = g_main_loop_get_context(loop);
-    cb_data->ctx = ctx;
-    cb_data->cb = cb;
-    cb_data->data = data;
-
-    GSource *source = g_timeout_source_new(interval);
-    g_source_set_callback(source, IdlerHandler, cb_data, DestroyNotify);
-    unsigned int id = g_source_attach(source, cb_data->ctx);
-    g_source_unref(source);
-
-    return id;
+    return loop->AddTimeout(interval, cb, user_data);
 }
 
 void MainLoopHandler::RemoveTimeout(unsigned int id)
 {
-    GSource *source;
-    source = g_main_context_find_source_by_id(g_main_loop_get_context(loop), id);
-    if (source)
-        g_source_destroy(source);
+    loop->RemoveTimeout(id);
 }
 
-void MainLoopHandler::AddIdle(MainLoopHandler *handle, const mainLoopCB &cb,
+MainLoopHandler::TimerID MainLoopHandler::AddTimer(int interval, const mainLoopCB &cb,
       MainLoopData *user_data)
 {
-    RET_IF(handle == nullptr);
-
-    MainLoopCbData *cb_data = new MainLoopCbData();
-    cb_data->cb = cb;
-    cb_data->data = user_data;
-    cb_data->ctx = g_main_loop_get_context(handle->loop);
+    uint64_t now = Now();
+    std::lock_guard<std::mutex> lock(timers_lock);
+    if (timers.Size() == 0) {
+        // Catches up with the time first, so that nothing is left to cascade
+        std::vector<Timer> none;
+        timers.Expire(now - 1, none);
+    }
 
-    AddIdle(cb_data, DestroyNotify);
+    TimerID id = timers.Add(now + interval, Timer(cb, user_data));
+    ScheduleTimers();
+    return id;
 }
 
-void MainLoopHandler::AddIdle(MainLoopCbData *cb_data, GDestroyNotify destroy)
+bool MainLoopHandler::RearmTimer(TimerID id, int interval)
 {
-    RET_IF(cb_data->ctx == nullptr);
+    uint64_t now = Now();
+    std::lock_guard<std::mutex> lock(timers_lock);
+    if (timers.Rearm(id, now + interval) == false)
+        return false;
 
-    GSource *source = g_idle_source_new();
-    g_source_set_priority(source, G_PRIORITY_HIGH);
-    g_source_set_callback(source, IdlerHandler, cb_data, destroy);
-    g_source_attach(source, cb_data->ctx);
-    g_source_unref(source);
+    ScheduleTimers();
+    return true;
 }
 
-gboolean MainLoopHandler::IdlerHandler(gpointer user_data)
+// The timeout of the loop is left as it is, and finds nothing to expire at worst
+void MainLoopHandler::RemoveTimer(TimerID id)
 {
-    RETV_IF(user_data == nullptr, FALSE);
-
-    MainLoopCbData *cb_data = static_cast<MainLoopCbData *>(user_data);
-
-    cb_data->cb(cb_data->result, cb_data->fd, cb_data->data);
-
-    return FALSE;
+    std::lock_guard<std::mutex> lock(timers_lock);
+    timers.Remove(id);
 }
 
-gboolean MainLoopHandler::EventHandler(GIOChannel *src, GIOCondition condition, gpointer user_data)
+uint64_t MainLoopHandler::Now(void)
 {
-    RETV_IF(user_data == nullptr, FALSE);
-
-    int ret = TRUE;
-    MainLoopCbData *cb_data = static_cast<MainLoopCbData *>(user_data);
-
-    if ((G_IO_HUP | G_IO_ERR) & condition) {
-        ERR("Connection Error(%d)", condition);
-        cb_data->result = (G_IO_HUP & condition) ? HANGUP : ERROR;
-        ret = FALSE;
-    }
-
-    cb_data->cb(cb_data->result, cb_data->fd, cb_data->data);
-
-    return ret;
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+          std::chrono::steady_clock::now().time_since_epoch())
+          .count();
 }
 
-void MainLoopHandler::DestroyNotify(gpointer data)
+// Called with timers_lock. The loop is touched only when the wheel has to run earlier.
+void MainLoopHandler::ScheduleTimers(void)
 {
-    MainLoopCbData *cb_data = static_cast<MainLoopCbData *>(data);
-    delete cb_data;
+    uint64_t next = timers.NextTick();
+    if (tick_time <= next)
+        return;
+
+    if (tick_id)
+        loop->RemoveTimeout(tick_id);
+
+    uint64_t now = Now();
+    unsigned int serial = ++tick_serial;
+    tick_time = next;
+    tick_id = loop->AddTimeout(
+          (now < next) ? next - now : 0,
+          [this, serial](MainLoopResult result, int fd, MainLoopData *data) {
+              ExpireTimers(serial);
+          },
+          nullptr);
 }
 
-MainLoopHandler::MainLoopCbData::MainLoopCbData() : data(nullptr), result(OK), fd(-1), ctx(nullptr)
+void MainLoopHandler::ExpireTimers(unsigned int serial)
 {
+    std::vector<Timer> expired;
+    {
+        std::lock_guard<std::mutex> lock(timers_lock);
+        // Otherwise it has been replaced by an earlier one, which is still pending
+        if (serial == tick_serial) {
+            tick_id = 0;
+            tick_time = TimerWheel<Timer>::NEVER;
+        }
+
+        timers.Expire(Now(), expired);
+        ScheduleTimers();
+    }
+
+    for (Timer &timer : expired)
+        timer.first(OK, -1, timer.second);
 }
 
 }  // namespace aitt
@@ -16,57 +16,61 @@
 #pragma once
 
 #include <AittTypes.h>
-#include <glib.h>
+#include <stdint.h>
 
-#include <functional>
-#include <map>
+#include <memory>
 #include <mutex>
+#include <utility>
+
+#include "MainLoopIface.h"
+#include "TimerWheel.h"
 
 namespace aitt {
 
-class MainLoopHandler {
+class MainLoopHandler : public MainLoopIface {
   public:
-    enum MainLoopResult {
-        OK,
-        ERROR,
-        REMOVED,
-        HANGUP,
-    };
-    struct MainLoopData {
-        virtual ~MainLoopData() = default;
+    using TimerID = TimerWheel<int>::Handle;
+
+    enum Backend {
+        DEFAULT_BACKEND,  // POSIX_BACKEND if built with POSIX_MAINLOOP, GLIB_BACKEND otherwise
+        GLIB_BACKEND,
+        POSIX_BACKEND,  // epoll, see PosixMainLoop
     };
-    using mainLoopCB = std::function<void(MainLoopResult result, int fd, MainLoopData *data)>;
 
-    MainLoopHandler();
-    ~MainLoopHandler();
+    explicit MainLoopHandler(Backend backend = DEFAULT_BACKEND);
+    ~MainLoopHandler() = default;
 
     static void AddIdle(MainLoopHandler *handle, const mainLoopCB &cb, MainLoopData *user_data);
 
-    void Run();
-    bool Quit();
-    void AddWatch(int fd, const mainLoopCB &cb, MainLoopData *user_data);
-    MainLoopData *RemoveWatch(int fd);
-    unsigned int AddTimeout(int interval, const mainLoopCB &cb, MainLoopData *user_data);
-    void RemoveTimeout(unsigned int id);
+    void Run() override;
+    bool Quit() override;
+    void AddIdle(const mainLoopCB &cb, MainLoopData *user_data) override;
+    void AddWatch(int fd, const mainLoopCB &cb, MainLoopData *user_data) override;
+    MainLoopData *RemoveWatch(int fd) override;
+    unsigned int AddTimeout(int interval, const mainLoopCB &cb, MainLoopData *user_data) override;
+    void RemoveTimeout(unsigned int id) override;
+
+    // Timeouts kept in a timer wheel, which is driven by a single timeout of the loop set to
+    // its earliest tick. Adding, re-arming and removing one is O(1) and mostly does not touch
+    // the loop, for many short lived timeouts such as the ones of requests.
+    // The callback is invoked once with fd -1, like the one of AddTimeout().
+    TimerID AddTimer(int interval, const mainLoopCB &cb, MainLoopData *user_data);
+    // Restarts the timer to expire interval ms from now. false if it expired or was removed.
+    bool RearmTimer(TimerID id, int interval);
+    void RemoveTimer(TimerID id);
 
   private:
-    struct MainLoopCbData {
-        MainLoopCbData();
-        mainLoopCB cb;
-        MainLoopData *data;
-        MainLoopResult result;
-        int fd;
-        GMainContext *ctx;
-    };
-    using CallbackMap = std::map<int, std::pair<GSource *, MainLoopCbData *>>;
+    using Timer = std::pair<mainLoopCB, MainLoopData *>;
 
-    static void AddIdle(MainLoopCbData *, GDestroyNotify);
-    static gboolean IdlerHandler(gpointer user_data);
-    static gboolean EventHandler(GIOChannel *src, GIOCondition cond, gpointer user_data);
-    static void DestroyNotify(gpointer data);
+    static uint64_t Now(void);
+    void ScheduleTimers(void);
+    void ExpireTimers(unsigned int serial);
 
-    GMainLoop *loop;
-    CallbackMap callback_table;
-    std::mutex callback_table_lock;
+    std::unique_ptr<MainLoopIface> loop;
+    TimerWheel<Timer> timers;
+    std::mutex timers_lock;
+    unsigned int tick_id;  // timeout of the loop driving the wheel, 0 if none
+    uint64_t tick_time;    // when it expires
+    unsigned int tick_serial;
 };
 }  // namespace aitt
@@ -0,0 +1,53 @@
+/*
+ * Copyright (c) 2022 Samsung Electronics Co., Ltd All Rights Reserved
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+
+#include <functional>
+
+namespace aitt {
+
+// Event loop of a thread. Run() and the callbacks are on the thread of the loop, and the other
+// functions may be called from any thread.
+class MainLoopIface {
+  public:
+    enum MainLoopResult {
+        OK,
+        ERROR,
+        REMOVED,
+        HANGUP,
+    };
+    struct MainLoopData {
+        virtual ~MainLoopData() = default;
+    };
+    using mainLoopCB = std::function<void(MainLoopResult result, int fd, MainLoopData *data)>;
+
+    virtual ~MainLoopIface() = default;
+
+    virtual void Run() = 0;
+    // Returns false if the loop is not running
+    virtual bool Quit() = 0;
+    // cb is invoked once, before the events of the watches
+    virtual void AddIdle(const mainLoopCB &cb, MainLoopData *user_data) = 0;
+    // cb is invoked while fd is readable. After HANGUP or ERROR, it is not invoked anymore.
+    virtual void AddWatch(int fd, const mainLoopCB &cb, MainLoopData *user_data) = 0;
+    virtual MainLoopData *RemoveWatch(int fd) = 0;
+    // cb is invoked once, after interval milliseconds
+    virtual unsigned int AddTimeout(int interval, const mainLoopCB &cb,
+          MainLoopData *user_data) = 0;
+    virtual void RemoveTimeout(unsigned int id) = 0;
+};
+
+}  // namespace aitt
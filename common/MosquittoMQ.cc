@@ -21,25 +21,37 @@
 
 #include <algorithm>
 #include <cerrno>
+#include <random>
 #include <stdexcept>
 #include <thread>
 
 #include "AittException.h"
 #include "AittTypes.h"
-#include "AittUtil.h"
 #include "aitt_internal.h"
 
 namespace aitt {
 
 const std::string MosquittoMQ::REPLY_SEQUENCE_NUM_KEY = "sequenceNum";
 const std::string MosquittoMQ::REPLY_IS_END_SEQUENCE_KEY = "isEndSequence";
+const std::string MosquittoMQ::REPLY_HEADER_KEY = "replyHeader";
+const uint8_t MosquittoMQ::REPLY_HEADER_MAGIC[2] = {0xA1, 0x77};
 
 MosquittoMQ::MosquittoMQ(const std::string &id, bool clear_session)
       : handle(nullptr),
         keep_alive(60),
+        next_subscription_id(1),
+        subscription_id_available(false),
+        subscribe_order(0),
         subscribers_iterating(false),
-        subscriber_iterator_updated(false),
-        connect_cb(nullptr)
+        delivering_message(nullptr),
+        delivering_payload(nullptr),
+        connect_cb(nullptr),
+        legacy_reply_format(false),
+        topic_alias_max(0),
+        max_queued(0),
+        track_pending(false),
+        pending_count(0),
+        reserving(0)
 {
     do {
         int ret = mosquitto_lib_init();
@@ -63,6 +75,7 @@ MosquittoMQ::MosquittoMQ(const std::string &id, bool clear_session)
         mosquitto_message_v5_callback_set(handle, MessageCallback);
         mosquitto_connect_v5_callback_set(handle, ConnectCallback);
         mosquitto_disconnect_v5_callback_set(handle, DisconnectCallback);
+        mosquitto_publish_v5_callback_set(handle, PublishCallback);
 
         return;
     } while (0);
@@ -79,9 +92,15 @@ MosquittoMQ::~MosquittoMQ(void)
 
     callback_lock.lock();
     connect_cb = nullptr;
-    subscribers.clear();
+    subscribers.ForEach([](SubscribeData *data) { delete data; });
+    subscribers.Clear();
     callback_lock.unlock();
 
+    pending_lock.lock();
+    publish_ack_cb = nullptr;
+    track_pending = false;
+    pending_lock.unlock();
+
     mosquitto_destroy(handle);
 
     ret = mosquitto_lib_cleanup();
@@ -95,6 +114,28 @@ void MosquittoMQ::SetConnectionCallback(const MQConnectionCallback &cb)
     connect_cb = cb;
 }
 
+void MosquittoMQ::SetPublishAckCallback(const PublishAckCallback &cb)
+{
+    std::lock_guard<std::mutex> lock(pending_lock);
+    publish_ack_cb = cb;
+    track_pending = (max_queued > 0 || publish_ack_cb);
+}
+
+void MosquittoMQ::SetPublishLimits(int inflight_limit, int queued_limit)
+{
+    if (inflight_limit > 0) {
+        int ret = mosquitto_int_option(handle, MOSQ_OPT_SEND_MAXIMUM, inflight_limit);
+        if (ret != MOSQ_ERR_SUCCESS) {
+            ERR("mosquitto_int_option(%d) Fail(%s)", inflight_limit, mosquitto_strerror(ret));
+            throw AittException(AittException::MQTT_ERR);
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(pending_lock);
+    max_queued = queued_limit;
+    track_pending = (max_queued > 0 || publish_ack_cb);
+}
+
 void MosquittoMQ::ConnectCallback(struct mosquitto *mosq, void *obj, int rc, int flag,
       const mosquitto_property *props)
 {
@@ -103,7 +144,23 @@ void MosquittoMQ::ConnectCallback(struct mosquitto *mosq, void *obj, int rc, int
 
     INFO("Connected : rc(%d), flag(%d)", rc, flag);
 
+    uint16_t alias_max = 0;
+    if (rc == CONNACK_ACCEPTED)
+        mosquitto_property_read_int16(props, MQTT_PROP_TOPIC_ALIAS_MAXIMUM, &alias_max, false);
+    mq->ResetTopicAliases(alias_max);
+
     std::lock_guard<std::recursive_mutex> lock_from_here(mq->callback_lock);
+    if (rc == CONNACK_ACCEPTED) {
+        // Available unless the broker says otherwise
+        uint8_t id_available = 1;
+        mosquitto_property_read_byte(props, MQTT_PROP_SUBSCRIPTION_ID_AVAILABLE, &id_available,
+              false);
+        mq->subscription_id_available = (id_available != 0);
+
+        // The broker kept the subscriptions only if it says the session is present. Those made
+        // while disconnected never reached it either way.
+        mq->RestoreSubscriptions((flag & 0x01) != 0);
+    }
     if (mq->connect_cb)
         mq->connect_cb((rc == CONNACK_ACCEPTED) ? AITT_CONNECTED : AITT_CONNECT_FAILED);
 }
@@ -116,11 +173,33 @@ void MosquittoMQ::DisconnectCallback(struct mosquitto *mosq, void *obj, int rc,
 
     INFO("Disconnected : rc(%d)", rc);
 
+    mq->ResetTopicAliases(0);
+
+    // Unexpected disconnection, libmosquitto reconnects after the delay
+    if (rc != MOSQ_ERR_SUCCESS)
+        mq->SetReconnectDelay();
+
     std::lock_guard<std::recursive_mutex> lock_from_here(mq->callback_lock);
     if (mq->connect_cb)
         mq->connect_cb(AITT_DISCONNECTED);
 }
 
+// libmosquitto waits for delay * attempts^2 seconds before each attempt, up to the maximum.
+// Both are chosen at random, so that clients dropped at the same time do not come back at once.
+void MosquittoMQ::SetReconnectDelay(void)
+{
+    std::mt19937 random_gen{std::random_device{}()};
+    std::uniform_int_distribution<unsigned int> delay(RECONNECT_DELAY_MIN,
+          RECONNECT_DELAY_MIN * 2);
+    std::uniform_int_distribution<unsigned int> delay_max(RECONNECT_DELAY_MAX / 2,
+          RECONNECT_DELAY_MAX);
+
+    int ret =
+          mosquitto_reconnect_delay_set(handle, delay(random_gen), delay_max(random_gen), true);
+    if (ret != MOSQ_ERR_SUCCESS)
+        ERR("mosquitto_reconnect_delay_set() Fail(%s)", mosquitto_strerror(ret));
+}
+
 void MosquittoMQ::Connect(const std::string &host, int port, const std::string &username,
       const std::string &password)
 {
@@ -135,15 +214,23 @@ void MosquittoMQ::Connect(const std::string &host, int port, const std::string &
         }
     }
 
+    SetReconnectDelay();
+
     ret = mosquitto_loop_start(handle);
     if (ret != MOSQ_ERR_SUCCESS) {
         ERR("mosquitto_loop_start() Fail(%s)", mosquitto_strerror(ret));
         throw AittException(AittException::MQTT_ERR);
     }
 
-    ret = mosquitto_connect(handle, host.c_str(), port, keep_alive);
-    if (ret != MOSQ_ERR_SUCCESS) {
-        ERR("mosquitto_connect(%s, %d) Fail(%s)", host.c_str(), port, mosquitto_strerror(ret));
+    // Returns without waiting for CONNACK, which is reported by the connection callback.
+    // If the broker is not reachable yet, the network thread keeps trying to connect.
+    ret = mosquitto_connect_async(handle, host.c_str(), port, keep_alive);
+    if (ret == MOSQ_ERR_ERRNO) {
+        INFO("mosquitto_connect_async(%s, %d) Fail(%s), retry later", host.c_str(), port,
+              mosquitto_strerror(ret));
+    } else if (ret != MOSQ_ERR_SUCCESS) {
+        ERR("mosquitto_connect_async(%s, %d) Fail(%s)", host.c_str(), port,
+              mosquitto_strerror(ret));
         throw AittException(AittException::MQTT_ERR);
     }
 }
@@ -180,39 +267,66 @@ void MosquittoMQ::MessageCallback(mosquitto *handle, void *obj, const mosquitto_
     MosquittoMQ *mq = static_cast<MosquittoMQ *>(obj);
 
     std::lock_guard<std::recursive_mutex> auto_lock(mq->callback_lock);
-    mq->subscribers_iterating = true;
-    mq->subscriber_iterator = mq->subscribers.begin();
-    while (mq->subscriber_iterator != mq->subscribers.end()) {
-        auto subscribe_data = *(mq->subscriber_iterator);
-        if (nullptr == subscribe_data) {
-            ERR("Invalid subscribe data");
-            mq->subscriber_iterator++;
-            continue;
+    std::vector<SubscribeData *> &matched = mq->matched_subscribers;
+    matched.clear();
+
+    // The broker tags the message with the identifiers of the subscriptions it matched.
+    // Filters subscribed without one (before CONNACK) are not tagged, so fall back to matching
+    // while any of them remains.
+    uint32_t id = 0;
+    const mosquitto_property *prop = nullptr;
+    if (mq->subscription_ids.size() == mq->filter_subscriptions.size())
+        prop = mosquitto_property_read_varint(props, MQTT_PROP_SUBSCRIPTION_IDENTIFIER, &id, false);
+    if (prop == nullptr)
+        mq->subscriber_index.Match(msg->topic, matched);
+    while (prop) {
+        auto it = mq->subscription_ids.find(id);
+        if (it != mq->subscription_ids.end()) {
+            std::vector<SubscribeData *> &subscribers = it->second->subscribers;
+            matched.insert(matched.end(), subscribers.begin(), subscribers.end());
         }
+        prop = mosquitto_property_read_varint(prop, MQTT_PROP_SUBSCRIPTION_IDENTIFIER, &id,
+              true);
+    }
+    if (matched.empty())
+        return;
 
-        bool result = AittUtil::CompareTopic(subscribe_data->topic.c_str(), msg->topic);
-        if (result)
-            mq->InvokeCallback(*mq->subscriber_iterator, msg, props);
+    if (matched.size() > 1) {
+        std::sort(matched.begin(), matched.end(),
+              [](const SubscribeData *a, const SubscribeData *b) { return a->order < b->order; });
+    }
 
-        if (!mq->subscriber_iterator_updated)
-            mq->subscriber_iterator++;
-        else
-            mq->subscriber_iterator_updated = false;
+    // Callbacks can subscribe or unsubscribe. New subscribers are not matched against this
+    // message, and unsubscribed ones are skipped and deleted after the loop.
+    mq->subscribers_iterating = true;
+    // libmosquitto frees the message after this callback. SharePayload() can take the payload
+    // over instead, so keep the pointer here for the other subscribers.
+    mq->delivering_message = const_cast<mosquitto_message *>(msg);
+    mq->delivering_payload = msg->payload;
+    for (size_t i = 0; i < matched.size(); i++) {
+        if (matched[i]->removed)
+            continue;
+        mq->InvokeCallback(matched[i], msg, mq->delivering_payload, props);
     }
+    mq->delivering_message = nullptr;
+    mq->delivering_payload = nullptr;
+    mq->shared_payload.reset();
     mq->subscribers_iterating = false;
-    mq->subscribers.insert(mq->subscribers.end(), mq->new_subscribers.begin(),
-          mq->new_subscribers.end());
-    mq->new_subscribers.clear();
+
+    for (auto subscribe_data : mq->removed_subscribers)
+        delete subscribe_data;
+    mq->removed_subscribers.clear();
 }
 
 void MosquittoMQ::InvokeCallback(SubscribeData *subscriber, const mosquitto_message *msg,
-      const mosquitto_property *props)
+      const void *payload, const mosquitto_property *props)
 {
     RET_IF(nullptr == subscriber);
 
     MSG mq_msg;
     mq_msg.SetTopic(msg->topic);
-    if (props) {
+    // With subscription identifiers, plain messages have properties too
+    if (HasReplyProperty(props)) {
         const mosquitto_property *prop;
 
         char *response_topic = nullptr;
@@ -225,24 +339,30 @@ void MosquittoMQ::InvokeCallback(SubscribeData *subscriber, const mosquitto_mess
 
         void *correlation = nullptr;
         uint16_t correlation_size = 0;
-        prop = mosquitto_property_read_binary(props, MQTT_PROP_CORRELATION_DATA, &correlation,
+        mosquitto_property_read_binary(props, MQTT_PROP_CORRELATION_DATA, &correlation,
               &correlation_size, false);
-        if (prop == nullptr || correlation == nullptr)
-            ERR("No Correlation Data");
 
-        mq_msg.SetCorrelation(std::string((char *)correlation, correlation_size));
+        // Requests have a response topic, and replies in the legacy format have user properties
+        bool decoded = false;
+        if (mq_msg.GetResponseTopic().empty() && HasUserProperty(props) == false)
+            decoded = DecodeReplyHeader(correlation, correlation_size, mq_msg);
+        if (decoded == false)
+            mq_msg.SetCorrelation(std::string((char *)correlation, correlation_size));
         if (correlation)
             free(correlation);
 
         char *name = nullptr;
         char *value = nullptr;
-        prop = mosquitto_property_read_string_pair(props, MQTT_PROP_USER_PROPERTY, &name, &value,
-              false);
+        prop = decoded ? nullptr
+                       : mosquitto_property_read_string_pair(props, MQTT_PROP_USER_PROPERTY, &name,
+                             &value, false);
         while (prop) {
             if (REPLY_SEQUENCE_NUM_KEY == name) {
                 mq_msg.SetSequence(std::stoi(value));
             } else if (REPLY_IS_END_SEQUENCE_KEY == name) {
                 mq_msg.SetEndSequence(std::stoi(value) == 1);
+            } else if (REPLY_HEADER_KEY == name) {
+                mq_msg.SetReplyHeaderAccepted(std::stoi(value) == 1);
             } else {
                 ERR("Unsupported property(%s, %s)", name, value);
             }
@@ -254,142 +374,516 @@ void MosquittoMQ::InvokeCallback(SubscribeData *subscriber, const mosquitto_mess
         }
     }
 
-    subscriber->cb(&mq_msg, msg->topic, msg->payload, msg->payloadlen, subscriber->user_data);
+    subscriber->cb(&mq_msg, msg->topic, payload, msg->payloadlen, subscriber->user_data);
 }
 
 void MosquittoMQ::Publish(const std::string &topic, const void *data, const size_t datalen, int qos,
       bool retain)
 {
+    // libmosquitto resends QoS 1 and 2 messages as they are after reconnecting, when the aliases
+    // are no longer valid. So only QoS 0 messages use them.
+    if (qos == 0 && PublishWithTopicAlias(topic, data, datalen, retain))
+        return;
+
+    bool tracked = ReservePending(qos);
     int mid = -1;
     int ret = mosquitto_publish(handle, &mid, topic.c_str(), datalen, data, qos, retain);
     if (ret != MOSQ_ERR_SUCCESS) {
         ERR("mosquitto_publish(%s) Fail(%s)", topic.c_str(), mosquitto_strerror(ret));
+        CancelPending(tracked);
         throw AittException(AittException::MQTT_ERR);
     }
+    AddPending(tracked, mid, topic);
 }
 
-void MosquittoMQ::PublishWithReply(const std::string &topic, const void *data, const size_t datalen,
-      int qos, bool retain, const std::string &reply_topic, const std::string &correlation)
+// Reserves a place among the pending messages for a QoS 1 or 2 message, if they are tracked for
+// SetPublishLimits() or SetPublishAckCallback(). Returns whether it did, to be passed to
+// AddPending() or CancelPending() after mosquitto_publish().
+bool MosquittoMQ::ReservePending(int qos)
 {
-    int ret;
-    int mid = -1;
-    mosquitto_property *props = nullptr;
+    if (qos == 0 || track_pending.load(std::memory_order_acquire) == false)
+        return false;
+
+    int queued = pending_count.fetch_add(1, std::memory_order_acq_rel);
+    int limit = max_queued.load(std::memory_order_relaxed);
+    if (limit && queued >= limit) {
+        pending_count.fetch_sub(1, std::memory_order_acq_rel);
+        throw AittException(AittException::WOULD_BLOCK_ERR);
+    }
 
-    ret = mosquitto_property_add_string(&props, MQTT_PROP_RESPONSE_TOPIC, reply_topic.c_str());
-    if (ret != MOSQ_ERR_SUCCESS) {
-        ERR("mosquitto_property_add_string(response-topic) Fail(%s)", mosquitto_strerror(ret));
-        throw AittException(AittException::MQTT_ERR);
+    reserving.fetch_add(1, std::memory_order_acq_rel);
+    return true;
+}
+
+// The acknowledgement can come before the message is added, then PublishCallback() keeps it in
+// early_acks while any message is being reserved.
+void MosquittoMQ::AddPending(bool reserved, int mid, const std::string &topic)
+{
+    if (reserved == false)
+        return;
+
+    std::unique_lock<std::mutex> lock(pending_lock);
+    int reason_code = 0;
+    auto early = early_acks.find(mid);
+    bool acked = (early != early_acks.end());
+    if (acked) {
+        reason_code = early->second;
+        early_acks.erase(early);
+        pending_count.fetch_sub(1, std::memory_order_acq_rel);
+    } else {
+        pending_publishes[mid] = topic;
     }
+    if (reserving.fetch_sub(1, std::memory_order_acq_rel) == 1)
+        early_acks.clear();  // of QoS 0 messages
+    PublishAckCallback cb = publish_ack_cb;
+    lock.unlock();
 
-    ret = mosquitto_property_add_binary(&props, MQTT_PROP_CORRELATION_DATA, correlation.c_str(),
-          correlation.size());
+    if (acked && cb)
+        cb(topic, reason_code);
+}
+
+void MosquittoMQ::CancelPending(bool reserved)
+{
+    if (reserved == false)
+        return;
+
+    std::lock_guard<std::mutex> lock(pending_lock);
+    pending_count.fetch_sub(1, std::memory_order_acq_rel);
+    if (reserving.fetch_sub(1, std::memory_order_acq_rel) == 1)
+        early_acks.clear();
+}
+
+void MosquittoMQ::PublishCallback(struct mosquitto *mosq, void *obj, int mid, int reason_code,
+      const mosquitto_property *props)
+{
+    RET_IF(obj == nullptr);
+    MosquittoMQ *mq = static_cast<MosquittoMQ *>(obj);
+
+    std::unique_lock<std::mutex> lock(mq->pending_lock);
+    auto it = mq->pending_publishes.find(mid);
+    if (it == mq->pending_publishes.end()) {
+        // QoS 0 or not tracked, unless the publishing thread has not added it yet
+        if (mq->reserving.load(std::memory_order_acquire) > 0)
+            mq->early_acks[mid] = reason_code;
+        return;
+    }
+
+    std::string topic = std::move(it->second);
+    mq->pending_publishes.erase(it);
+    mq->pending_count.fetch_sub(1, std::memory_order_acq_rel);
+    PublishAckCallback cb = mq->publish_ack_cb;
+    lock.unlock();
+
+    if (cb)
+        cb(topic, reason_code);
+}
+
+bool MosquittoMQ::PublishWithTopicAlias(const std::string &topic, const void *data,
+      const size_t datalen, bool retain)
+{
+    std::lock_guard<std::mutex> lock(topic_alias_lock);
+    if (topic_alias_max == 0)
+        return false;
+
+    uint16_t alias;
+    const char *alias_topic = nullptr;
+    auto it = topic_aliases.find(topic);
+    if (it != topic_aliases.end()) {
+        alias = it->second;
+    } else {
+        if (topic_aliases.size() >= topic_alias_max)
+            return false;
+
+        // The topic is sent along with the new alias
+        alias = topic_aliases.size() + 1;
+        topic_aliases.emplace(topic, alias);
+        alias_topic = topic.c_str();
+    }
+
+    PropertyList props;
+    props.AddInt16(MQTT_PROP_TOPIC_ALIAS, alias);
+
+    // The lock is kept until the message is queued, so that no message is sent with the alias
+    // alone before the broker learns it, nor after a reconnection resets the aliases.
+    int mid = -1;
+    int ret = mosquitto_publish_v5(handle, &mid, alias_topic, datalen, data, 0, retain,
+          props.Get());
     if (ret != MOSQ_ERR_SUCCESS) {
-        ERR("mosquitto_property_add_binary(correlation) Fail(%s)", mosquitto_strerror(ret));
+        ERR("mosquitto_publish_v5(%s) Fail(%s)", topic.c_str(), mosquitto_strerror(ret));
+        if (alias_topic)
+            topic_aliases.erase(topic);
         throw AittException(AittException::MQTT_ERR);
     }
-    ret = mosquitto_publish_v5(handle, &mid, topic.c_str(), datalen, data, qos, retain, props);
+
+    return true;
+}
+
+void MosquittoMQ::ResetTopicAliases(uint16_t alias_max)
+{
+    std::lock_guard<std::mutex> lock(topic_alias_lock);
+    topic_aliases.clear();
+    topic_alias_max = alias_max;
+}
+
+void MosquittoMQ::PublishWithReply(const std::string &topic, const void *data, const size_t datalen,
+      int qos, bool retain, const std::string &reply_topic, const std::string &correlation)
+{
+    int mid = -1;
+    PropertyList props;
+    props.AddString(MQTT_PROP_RESPONSE_TOPIC, reply_topic.c_str());
+    props.AddBinary(MQTT_PROP_CORRELATION_DATA, correlation.c_str(), correlation.size());
+    if (legacy_reply_format == false)
+        props.AddStringPair(REPLY_HEADER_KEY.c_str(), "1");
+
+    bool tracked = ReservePending(qos);
+    int ret = mosquitto_publish_v5(handle, &mid, topic.c_str(), datalen, data, qos, retain,
+          props.Get());
     if (ret != MOSQ_ERR_SUCCESS) {
         ERR("mosquitto_publish_v5(%s) Fail(%s)", topic.c_str(), mosquitto_strerror(ret));
+        CancelPending(tracked);
         throw AittException(AittException::MQTT_ERR);
     }
+    AddPending(tracked, mid, topic);
 }
 
 void MosquittoMQ::SendReply(MSG *msg, const void *data, const size_t datalen, int qos, bool retain)
 {
     RET_IF(msg == nullptr);
 
-    int ret;
     int mId = -1;
-    mosquitto_property *props = nullptr;
+    const std::string &correlation = msg->GetCorrelation();
+    PropertyList props;
 
-    ret = mosquitto_property_add_binary(&props, MQTT_PROP_CORRELATION_DATA,
-          msg->GetCorrelation().c_str(), msg->GetCorrelation().size());
-    if (ret != MOSQ_ERR_SUCCESS) {
-        ERR("mosquitto_property_add_binary(correlation) Fail(%s)", mosquitto_strerror(ret));
-        throw AittException(AittException::MQTT_ERR);
-    }
-
-    ret = mosquitto_property_add_string_pair(&props, MQTT_PROP_USER_PROPERTY,
-          REPLY_SEQUENCE_NUM_KEY.c_str(), std::to_string(msg->GetSequence()).c_str());
-    if (ret != MOSQ_ERR_SUCCESS) {
-        ERR("mosquitto_property_add_string_pair(squenceNum) Fail(%s)", mosquitto_strerror(ret));
-        throw AittException(AittException::MQTT_ERR);
-    }
+    // Older peers do not mark their requests, and read the sequence from user properties only
+    if (legacy_reply_format || msg->IsReplyHeaderAccepted() == false) {
+        char sequence[12];
+        snprintf(sequence, sizeof(sequence), "%d", msg->GetSequence());
 
-    ret = mosquitto_property_add_string_pair(&props, MQTT_PROP_USER_PROPERTY,
-          REPLY_IS_END_SEQUENCE_KEY.c_str(), std::to_string(msg->IsEndSequence()).c_str());
-    if (ret != MOSQ_ERR_SUCCESS) {
-        ERR("mosquitto_property_add_string_pair(IsEndSequence) Fail(%s)", mosquitto_strerror(ret));
-        throw AittException(AittException::MQTT_ERR);
+        props.AddBinary(MQTT_PROP_CORRELATION_DATA, correlation.c_str(), correlation.size());
+        props.AddStringPair(REPLY_SEQUENCE_NUM_KEY.c_str(), sequence);
+        props.AddStringPair(REPLY_IS_END_SEQUENCE_KEY.c_str(), msg->IsEndSequence() ? "1" : "0");
+    } else {
+        uint32_t sequence = static_cast<uint32_t>(msg->GetSequence());
+        std::string encoded(REPLY_HEADER_LEN, '\0');
+        encoded[0] = REPLY_HEADER_MAGIC[0];
+        encoded[1] = REPLY_HEADER_MAGIC[1];
+        encoded[2] = msg->IsEndSequence() ? REPLY_HEADER_END_SEQUENCE : 0;
+        encoded[3] = (sequence >> 24) & 0xFF;
+        encoded[4] = (sequence >> 16) & 0xFF;
+        encoded[5] = (sequence >> 8) & 0xFF;
+        encoded[6] = sequence & 0xFF;
+        encoded += correlation;
+
+        props.AddBinary(MQTT_PROP_CORRELATION_DATA, encoded.c_str(), encoded.size());
     }
 
-    ret = mosquitto_publish_v5(handle, &mId, msg->GetResponseTopic().c_str(), datalen, data, qos,
-          retain, props);
+    bool tracked = ReservePending(qos);
+    int ret = mosquitto_publish_v5(handle, &mId, msg->GetResponseTopic().c_str(), datalen, data,
+          qos, retain, props.Get());
     if (ret != MOSQ_ERR_SUCCESS) {
         ERR("mosquitto_publish_v5(%s) Fail(%s)", msg->GetResponseTopic().c_str(),
               mosquitto_strerror(ret));
+        CancelPending(tracked);
         throw AittException(AittException::MQTT_ERR);
     }
+    AddPending(tracked, mId, msg->GetResponseTopic());
 }
 
 void *MosquittoMQ::Subscribe(const std::string &topic, const SubscribeCallback &cb, void *user_data,
       int qos)
 {
+    if (qos < AITT_QOS_AT_MOST_ONCE || AITT_QOS_EXACTLY_ONCE < qos) {
+        ERR("Invalid QoS(%d)", qos);
+        throw AittException(AittException::INVALID_ARG);
+    }
+
+    std::lock_guard<std::recursive_mutex> lock_from_here(callback_lock);
+
+    auto filter = filter_subscriptions.find(topic);
+    bool new_filter = (filter == filter_subscriptions.end());
+    if (new_filter) {
+        FilterSubscription subscription = {};
+        subscription.broker_qos = -1;
+        if (subscription_id_available) {
+            subscription.id = NextSubscriptionId();
+        }
+        filter = filter_subscriptions.emplace(topic, std::move(subscription)).first;
+        if (filter->second.id)
+            subscription_ids[filter->second.id] = &filter->second;
+    }
+
+    // Other subscribers of the filter already receive its messages, unless they asked for a lower
+    // QoS. Then the broker subscription is upgraded, which replaces the existing one.
+    if (filter->second.broker_qos < qos) {
+        try {
+            filter->second.pending = (SubscribeBroker(topic, qos, filter->second.id) == false);
+        } catch (std::exception &e) {
+            if (new_filter) {
+                subscription_ids.erase(filter->second.id);
+                filter_subscriptions.erase(filter);
+            }
+            throw;
+        }
+        filter->second.broker_qos = qos;
+    }
+
+    SubscribeData *data = new SubscribeData(topic, cb, user_data, qos, subscribe_order++);
+    subscriber_index.Insert(topic, data);
+    filter->second.subscribers.push_back(data);
+    filter->second.qos_count[qos]++;
+
+    return reinterpret_cast<void *>(subscribers.Insert(data));
+}
+
+uint32_t MosquittoMQ::NextSubscriptionId(void)
+{
+    uint32_t id = next_subscription_id;
+    // Subscription identifiers are from 1 to 268,435,455
+    next_subscription_id = (next_subscription_id % 268435455) + 1;
+    return id;
+}
+
+// Returns false if it is deferred until connected
+bool MosquittoMQ::SubscribeBroker(const std::string &topic, int qos, uint32_t id, int options)
+{
+    int ret;
     int mid = -1;
-    int ret = mosquitto_subscribe(handle, &mid, topic.c_str(), qos);
+
+    if (id || options) {
+        PropertyList props;
+        if (id)
+            props.AddVarint(MQTT_PROP_SUBSCRIPTION_IDENTIFIER, id);
+        ret = mosquitto_subscribe_v5(handle, &mid, topic.c_str(), qos, options, props.Get());
+    } else {
+        ret = mosquitto_subscribe(handle, &mid, topic.c_str(), qos);
+    }
+
+    if (ret == MOSQ_ERR_NO_CONN) {
+        // RestoreSubscriptions() subscribes it once connected
+        DBG("Not connected, subscribe %s later", topic.c_str());
+        return false;
+    }
+
     if (ret != MOSQ_ERR_SUCCESS) {
         ERR("mosquitto_subscribe(%s) Fail(%s)", topic.c_str(), mosquitto_strerror(ret));
         throw AittException(AittException::MQTT_ERR);
     }
+    return true;
+}
 
-    std::lock_guard<std::recursive_mutex> lock_from_here(callback_lock);
-    SubscribeData *data = new SubscribeData(topic, cb, user_data);
-    if (subscribers_iterating)
-        new_subscribers.push_back(data);
-    else
-        subscribers.push_back(data);
+// Subscribes every filter again on a new session, including those subscribed while connecting,
+// or only the deferred ones when the session is present.
+// SEND_RETAIN_IF_NEW keeps the broker from sending the retained messages again to a subscription
+// which already reached it.
+void MosquittoMQ::RestoreSubscriptions(bool pending_only)
+{
+    for (auto &filter : filter_subscriptions) {
+        FilterSubscription &subscription = filter.second;
+        if (pending_only && subscription.pending == false)
+            continue;
+
+        if (subscription.id == 0 && subscription_id_available) {
+            subscription.id = NextSubscriptionId();
+            subscription_ids[subscription.id] = &subscription;
+        }
 
-    return static_cast<void *>(data);
+        try {
+            subscription.pending = (SubscribeBroker(filter.first, subscription.broker_qos,
+                                          subscription.id, MQTT_SUB_OPT_SEND_RETAIN_IF_NEW)
+                                    == false);
+        } catch (std::exception &e) {
+            ERR("Restoring subscription of %s Fail(%s)", filter.first.c_str(), e.what());
+        }
+    }
 }
 
 void *MosquittoMQ::Unsubscribe(void *sub_handle)
 {
     std::lock_guard<std::recursive_mutex> auto_lock(callback_lock);
-    auto it = std::find(subscribers.begin(), subscribers.end(),
-          static_cast<SubscribeData *>(sub_handle));
-
-    if (it == subscribers.end()) {
+    SubscribeData *data = nullptr;
+    if (subscribers.Erase(reinterpret_cast<uintptr_t>(sub_handle), &data) == false) {
         ERR("No Subscription(%p)", sub_handle);
         throw AittException(AittException::NO_DATA_ERR);
     }
 
-    SubscribeData *data = static_cast<SubscribeData *>(sub_handle);
-
-    if (subscriber_iterator == it) {
-        subscriber_iterator = subscribers.erase(it);
-        subscriber_iterator_updated = true;
-    } else {
-        subscribers.erase(it);
+    subscriber_index.Remove(data->topic, data);
+
+    // The broker subscription is left as it is while other subscribers of the filter remain
+    bool last_subscriber = false;
+    int lower_qos = -1;
+    uint32_t id = 0;
+    auto filter = filter_subscriptions.find(data->topic);
+    if (filter != filter_subscriptions.end()) {
+        FilterSubscription &subscription = filter->second;
+        std::vector<SubscribeData *> &filter_subscribers = subscription.subscribers;
+        filter_subscribers.erase(
+              std::find(filter_subscribers.begin(), filter_subscribers.end(), data));
+        subscription.qos_count[data->qos]--;
+        if (filter_subscribers.empty()) {
+            last_subscriber = true;
+            subscription_ids.erase(subscription.id);
+            filter_subscriptions.erase(filter);
+        } else if (subscription.MaxQoS() < subscription.broker_qos) {
+            lower_qos = subscription.broker_qos = subscription.MaxQoS();
+            id = subscription.id;
+        }
     }
 
     void *user_data = data->user_data;
     std::string topic = data->topic;
-    delete data;
+    if (subscribers_iterating) {
+        data->removed = true;
+        removed_subscribers.push_back(data);
+    } else {
+        delete data;
+    }
 
-    int mid = -1;
-    int ret = mosquitto_unsubscribe(handle, &mid, topic.c_str());
+    if (lower_qos >= 0) {
+        // Not to be delivered at a higher QoS than the remaining subscribers need.
+        // If it fails, the current subscription just keeps working.
+        try {
+            if (SubscribeBroker(topic, lower_qos, id) == false)
+                filter_subscriptions[topic].pending = true;
+        } catch (std::exception &e) {
+            ERR("Downgrading QoS of %s Fail(%s)", topic.c_str(), e.what());
+        }
+    }
+
+    if (last_subscriber) {
+        int mid = -1;
+        int ret = mosquitto_unsubscribe(handle, &mid, topic.c_str());
+        if (ret != MOSQ_ERR_SUCCESS) {
+            ERR("mosquitto_unsubscribe(%s) Fail(%s)", topic.c_str(), mosquitto_strerror(ret));
+            throw AittException(AittException::MQTT_ERR);
+        }
+    }
+
+    return user_data;
+}
+
+std::shared_ptr<void> MosquittoMQ::SharePayload(const void *data, size_t datalen)
+{
+    std::lock_guard<std::recursive_mutex> auto_lock(callback_lock);
+    if (delivering_message == nullptr || data == nullptr || data != delivering_payload)
+        return MQ::SharePayload(data, datalen);
+
+    if (shared_payload == nullptr) {
+        shared_payload = std::shared_ptr<void>(delivering_message->payload, free);
+        delivering_message->payload = nullptr;
+    }
+
+    return shared_payload;
+}
+
+void MosquittoMQ::SetLegacyReplyFormat(bool legacy)
+{
+    legacy_reply_format = legacy;
+}
+
+bool MosquittoMQ::HasReplyProperty(const mosquitto_property *props)
+{
+    for (const mosquitto_property *prop = props; prop; prop = mosquitto_property_next(prop)) {
+        int identifier = mosquitto_property_identifier(prop);
+        if (identifier == MQTT_PROP_RESPONSE_TOPIC || identifier == MQTT_PROP_CORRELATION_DATA)
+            return true;
+    }
+    return false;
+}
+
+bool MosquittoMQ::HasUserProperty(const mosquitto_property *props)
+{
+    for (const mosquitto_property *prop = props; prop; prop = mosquitto_property_next(prop)) {
+        if (mosquitto_property_identifier(prop) == MQTT_PROP_USER_PROPERTY)
+            return true;
+    }
+    return false;
+}
+
+bool MosquittoMQ::DecodeReplyHeader(const void *correlation, uint16_t correlation_size, MSG &msg)
+{
+    const uint8_t *header = static_cast<const uint8_t *>(correlation);
+    if (header == nullptr || correlation_size < REPLY_HEADER_LEN
+          || header[0] != REPLY_HEADER_MAGIC[0] || header[1] != REPLY_HEADER_MAGIC[1])
+        return false;
+
+    uint32_t sequence = (static_cast<uint32_t>(header[3]) << 24)
+                        | (static_cast<uint32_t>(header[4]) << 16)
+                        | (static_cast<uint32_t>(header[5]) << 8) | header[6];
+    msg.SetSequence(static_cast<int>(sequence));
+    msg.SetEndSequence(header[2] & REPLY_HEADER_END_SEQUENCE);
+    msg.SetCorrelation(std::string(reinterpret_cast<const char *>(header + REPLY_HEADER_LEN),
+          correlation_size - REPLY_HEADER_LEN));
+    return true;
+}
+
+void MosquittoMQ::PropertyList::AddInt16(int identifier, uint16_t value)
+{
+    int ret = mosquitto_property_add_int16(&props, identifier, value);
     if (ret != MOSQ_ERR_SUCCESS) {
-        ERR("mosquitto_unsubscribe(%s) Fail(%s)", topic.c_str(), mosquitto_strerror(ret));
+        ERR("mosquitto_property_add_int16(%d) Fail(%s)", identifier, mosquitto_strerror(ret));
         throw AittException(AittException::MQTT_ERR);
     }
+}
 
-    return user_data;
+void MosquittoMQ::PropertyList::AddVarint(int identifier, uint32_t value)
+{
+    int ret = mosquitto_property_add_varint(&props, identifier, value);
+    if (ret != MOSQ_ERR_SUCCESS) {
+        ERR("mosquitto_property_add_varint(%d) Fail(%s)", identifier, mosquitto_strerror(ret));
+        throw AittException(AittException::MQTT_ERR);
+    }
+}
+
+void MosquittoMQ::PropertyList::AddString(int identifier, const char *value)
+{
+    int ret = mosquitto_property_add_string(&props, identifier, value);
+    if (ret != MOSQ_ERR_SUCCESS) {
+        ERR("mosquitto_property_add_string(%d) Fail(%s)", identifier, mosquitto_strerror(ret));
+        throw AittException(AittException::MQTT_ERR);
+    }
+}
+
+void MosquittoMQ::PropertyList::AddBinary(int identifier, const void *value, size_t len)
+{
+    if (UINT16_MAX < len) {
+        ERR("Invalid Size(%zu)", len);
+        throw AittException(AittException::INVALID_ARG);
+    }
+
+    int ret = mosquitto_property_add_binary(&props, identifier, value, len);
+    if (ret != MOSQ_ERR_SUCCESS) {
+        ERR("mosquitto_property_add_binary(%d) Fail(%s)", identifier, mosquitto_strerror(ret));
+        throw AittException(AittException::MQTT_ERR);
+    }
+}
+
+void MosquittoMQ::PropertyList::AddStringPair(const char *name, const char *value)
+{
+    int ret = mosquitto_property_add_string_pair(&props, MQTT_PROP_USER_PROPERTY, name, value);
+    if (ret != MOSQ_ERR_SUCCESS) {
+        ERR("mosquitto_property_add_string_pair(%s) Fail(%s)", name, mosquitto_strerror(ret));
+        throw AittException(AittException::MQTT_ERR);
+    }
 }
 
 MosquittoMQ::SubscribeData::SubscribeData(const std::string &in_topic,
-      const SubscribeCallback &in_cb, void *in_user_data)
-      : topic(in_topic), cb(in_cb), user_data(in_user_data)
+      const SubscribeCallback &in_cb, void *in_user_data, int in_qos, unsigned long long in_order)
+      : topic(in_topic),
+        cb(in_cb),
+        user_data(in_user_data),
+        qos(in_qos),
+        order(in_order),
+        removed(false)
+{
+}
+
+int MosquittoMQ::FilterSubscription::MaxQoS(void) const
 {
+    for (int qos = AITT_QOS_EXACTLY_ONCE; qos > AITT_QOS_AT_MOST_ONCE; qos--) {
+        if (qos_count[qos])
+            return qos;
+    }
+    return AITT_QOS_AT_MOST_ONCE;
 }
 
 }  // namespace aitt
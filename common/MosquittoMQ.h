@@ -16,14 +16,19 @@
 #pragma once
 
 #include <mosquitto.h>
+#include <stdint.h>
 
+#include <atomic>
 #include <functional>
 #include <mutex>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
 #include "MQ.h"
 #include "MSG.h"
+#include "SlotMap.h"
+#include "TopicTrie.h"
 
 #define MQTT_LOCALHOST "127.0.0.1"
 #define MQTT_PORT 1883
@@ -36,6 +41,7 @@ class MosquittoMQ : public MQ {
     virtual ~MosquittoMQ(void);
 
     void SetConnectionCallback(const MQConnectionCallback &cb);
+    void SetPublishAckCallback(const PublishAckCallback &cb);
     void Connect(const std::string &host, int port, const std::string &username,
           const std::string &password);
     void SetWillInfo(const std::string &topic, const void *msg, size_t szmsg, int qos, bool retain);
@@ -48,13 +54,56 @@ class MosquittoMQ : public MQ {
     void *Subscribe(const std::string &topic, const SubscribeCallback &cb,
           void *user_data = nullptr, int qos = 0);
     void *Unsubscribe(void *handle);
+    std::shared_ptr<void> SharePayload(const void *data, size_t datalen);
+    void SetLegacyReplyFormat(bool legacy);
+    // See AittOption::SetMaxInflight() and SetMaxQueued().
+    // inflight_limit is applied from the next connection.
+    void SetPublishLimits(int inflight_limit, int queued_limit);
 
   private:
     struct SubscribeData {
-        SubscribeData(const std::string &topic, const SubscribeCallback &cb, void *user_data);
+        SubscribeData(const std::string &topic, const SubscribeCallback &cb, void *user_data,
+              int qos, unsigned long long order);
         std::string topic;
         SubscribeCallback cb;
         void *user_data;
+        int qos;
+        unsigned long long order;  // subscription order, callbacks are invoked in this order
+        bool removed;              // unsubscribed while the message was being dispatched
+    };
+
+    // Subscribers of a topic filter, which share a single subscription on the broker.
+    // The broker subscription is made at the highest QoS requested by the subscribers, and only
+    // changes when that maximum does.
+    struct FilterSubscription {
+        int MaxQoS(void) const;
+
+        uint32_t id;  // subscription identifier, 0 if subscribed without one
+        int broker_qos;
+        bool pending;  // SUBSCRIBE of broker_qos not sent yet, for lack of a connection
+        int qos_count[AITT_QOS_EXACTLY_ONCE + 1];  // number of subscribers for each QoS
+        std::vector<SubscribeData *> subscribers;
+    };
+
+    // Property list of a message, freed when it goes out of scope.
+    // mosquitto_publish_v5() copies the properties instead of taking them over.
+    class PropertyList {
+      public:
+        PropertyList(void) : props(nullptr) {}
+        ~PropertyList(void) { mosquitto_property_free_all(&props); }
+
+        void AddInt16(int identifier, uint16_t value);
+        void AddVarint(int identifier, uint32_t value);
+        void AddString(int identifier, const char *value);
+        void AddBinary(int identifier, const void *value, size_t len);
+        void AddStringPair(const char *name, const char *value);
+        const mosquitto_property *Get(void) const { return props; }
+
+      private:
+        PropertyList(const PropertyList &) = delete;
+        PropertyList &operator=(const PropertyList &) = delete;
+
+        mosquitto_property *props;
     };
 
     static void ConnectCallback(struct mosquitto *mosq, void *obj, int rc, int flag,
@@ -63,21 +112,72 @@ class MosquittoMQ : public MQ {
           const mosquitto_property *props);
     static void MessageCallback(mosquitto *, void *, const mosquitto_message *,
           const mosquitto_property *);
-    void InvokeCallback(SubscribeData *subscriber, const mosquitto_message *msg,
+    static void PublishCallback(struct mosquitto *mosq, void *obj, int mid, int reason_code,
           const mosquitto_property *props);
+    bool ReservePending(int qos);
+    void AddPending(bool reserved, int mid, const std::string &topic);
+    void CancelPending(bool reserved);
+    void InvokeCallback(SubscribeData *subscriber, const mosquitto_message *msg,
+          const void *payload, const mosquitto_property *props);
+    bool SubscribeBroker(const std::string &topic, int qos, uint32_t id, int options = 0);
+    void RestoreSubscriptions(bool pending_only);
+    uint32_t NextSubscriptionId(void);
+    void SetReconnectDelay(void);
+    bool PublishWithTopicAlias(const std::string &topic, const void *data, const size_t datalen,
+          bool retain);
+    void ResetTopicAliases(uint16_t alias_max);
+
+    static bool HasReplyProperty(const mosquitto_property *props);
+    static bool HasUserProperty(const mosquitto_property *props);
+    static bool DecodeReplyHeader(const void *correlation, uint16_t correlation_size,
+          MSG &msg);
 
     static const std::string REPLY_SEQUENCE_NUM_KEY;
     static const std::string REPLY_IS_END_SEQUENCE_KEY;
+    // User property of a request whose sender decodes the reply header. Replies to the others
+    // carry the sequence as string user properties.
+    static const std::string REPLY_HEADER_KEY;
+    // Sequence of a reply, prefixed to its correlation data when the request accepts it:
+    // magic(2 bytes) | flags(1 byte) | sequence number(4 bytes, big endian)
+    static const uint8_t REPLY_HEADER_MAGIC[2];
+    static const uint8_t REPLY_HEADER_END_SEQUENCE = 0x01;
+    static const size_t REPLY_HEADER_LEN = 7;
+    // Range of the seconds to wait before reconnecting, see SetReconnectDelay()
+    static const unsigned int RECONNECT_DELAY_MIN = 1;
+    static const unsigned int RECONNECT_DELAY_MAX = 32;
 
     mosquitto *handle;
     const int keep_alive;
-    std::vector<SubscribeData *> subscribers;
+    SlotMap<SubscribeData *> subscribers;
+    TopicTrie<SubscribeData *> subscriber_index;  // for messages without subscription ids
+    std::unordered_map<std::string, FilterSubscription> filter_subscriptions;
+    std::unordered_map<uint32_t, FilterSubscription *> subscription_ids;
+    uint32_t next_subscription_id;
+    bool subscription_id_available;  // from CONNACK
+    unsigned long long subscribe_order;
     bool subscribers_iterating;
-    std::vector<SubscribeData *> new_subscribers;
-    std::vector<SubscribeData *>::iterator subscriber_iterator;
-    bool subscriber_iterator_updated;
+    std::vector<SubscribeData *> matched_subscribers;
+    std::vector<SubscribeData *> removed_subscribers;
+    mosquitto_message *delivering_message;
+    const void *delivering_payload;
+    std::shared_ptr<void> shared_payload;  // payload taken over from delivering_message
     std::recursive_mutex callback_lock;
     MQConnectionCallback connect_cb;
+    bool legacy_reply_format;
+    // Topic aliases of Publish(), which are valid only for the current connection
+    std::unordered_map<std::string, uint16_t> topic_aliases;
+    uint16_t topic_alias_max;  // Topic Alias Maximum of the broker, 0 if not supported
+    std::mutex topic_alias_lock;
+    // QoS 1 and 2 messages waiting for acknowledgements, by message id. Tracked only while
+    // max_queued or publish_ack_cb is set.
+    std::unordered_map<int, std::string> pending_publishes;
+    std::unordered_map<int, int> early_acks;  // reason codes of acks before AddPending()
+    std::atomic<int> max_queued;
+    PublishAckCallback publish_ack_cb;
+    std::mutex pending_lock;
+    std::atomic<bool> track_pending;
+    std::atomic<int> pending_count;  // pending_publishes and the reserved ones
+    std::atomic<int> reserving;      // between ReservePending() and AddPending()
 };
 
 }  // namespace aitt
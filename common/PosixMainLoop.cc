@@ -0,0 +1,306 @@
+/*
+ * Copyright (c) 2022 Samsung Electronics Co., Ltd All Rights Reserved
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "PosixMainLoop.h"
+
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/timerfd.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <stdexcept>
+
+#include "aitt_internal.h"
+
+#define EPOLL_EVENTS_MAX 64
+
+namespace aitt {
+
+// The epoll data of a source is its serial number and its fd, and 0 and event_fd for event_fd
+static uint64_t EventKey(uint32_t serial, int fd)
+{
+    return (static_cast<uint64_t>(serial) << 32) | static_cast<uint32_t>(fd);
+}
+
+PosixMainLoop::PosixMainLoop()
+      : epoll_fd(-1), event_fd(-1), running(false), next_serial(0), next_timeout_id(0)
+{
+    epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    if (epoll_fd == -1)
+        throw std::runtime_error("Failed to create an epoll");
+
+    event_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (event_fd == -1) {
+        close(epoll_fd);
+        throw std::runtime_error("Failed to create an eventfd");
+    }
+
+    struct epoll_event event = {};
+    event.events = EPOLLIN;
+    event.data.u64 = EventKey(0, event_fd);
+    if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, event_fd, &event) == -1) {
+        close(event_fd);
+        close(epoll_fd);
+        throw std::runtime_error("Failed to watch the eventfd");
+    }
+}
+
+PosixMainLoop::~PosixMainLoop()
+{
+    for (auto &timeout : timeouts)
+        close(timeout.second);
+    close(event_fd);
+    close(epoll_fd);
+}
+
+void PosixMainLoop::Run()
+{
+    struct epoll_event events[EPOLL_EVENTS_MAX];
+
+    running = true;
+    while (running) {
+        int count = epoll_wait(epoll_fd, events, EPOLL_EVENTS_MAX, -1);
+        if (count == -1) {
+            if (errno == EINTR)
+                continue;
+            ERR_CODE(errno, "epoll_wait() Fail");
+            break;
+        }
+
+        // Idles go first, as the GLib loop runs them at a higher priority than the watches
+        for (int i = 0; i < count; i++) {
+            if (events[i].data.u64 == EventKey(0, event_fd))
+                DispatchIdles();
+        }
+
+        for (int i = 0; i < count && running; i++) {
+            if (events[i].data.u64 != EventKey(0, event_fd))
+                Dispatch(events[i].data.u64, events[i].events);
+        }
+    }
+}
+
+bool PosixMainLoop::Quit()
+{
+    if (running.exchange(false) == false) {
+        ERR("main loop is not running");
+        return false;
+    }
+
+    Wakeup();
+    return true;
+}
+
+void PosixMainLoop::AddIdle(const mainLoopCB &cb, MainLoopData *user_data)
+{
+    bool wakeup;
+    {
+        std::lock_guard<std::mutex> lock(idles_lock);
+        // The loop is already woken up for the idles queued before
+        wakeup = idles.empty();
+        idles.emplace_back(cb, user_data);
+    }
+
+    if (wakeup)
+        Wakeup();
+}
+
+void PosixMainLoop::AddWatch(int fd, const mainLoopCB &cb, MainLoopData *user_data)
+{
+    std::shared_ptr<Source> source = std::make_shared<Source>(cb, user_data);
+
+    std::lock_guard<std::mutex> lock(sources_lock);
+    auto it = sources.find(fd);
+    if (it != sources.end()) {
+        if (it->second->active) {
+            ERR("fd(%d) is already watched", fd);
+            throw std::runtime_error("Failed to add a watch");
+        }
+        // Hung up and not removed yet
+        sources.erase(it);
+    }
+
+    AddSource(fd, source);
+}
+
+MainLoopIface::MainLoopData *PosixMainLoop::RemoveWatch(int fd)
+{
+    std::lock_guard<std::mutex> lock(sources_lock);
+    auto it = sources.find(fd);
+    if (it == sources.end() || it->second->timeout_id)
+        return nullptr;
+
+    std::shared_ptr<Source> source = it->second;
+    sources.erase(it);
+    DeactivateSource(fd, *source);
+
+    return source->data;
+}
+
+unsigned int PosixMainLoop::AddTimeout(int interval, const mainLoopCB &cb, MainLoopData *data)
+{
+    int fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    if (fd == -1) {
+        ERR_CODE(errno, "timerfd_create() Fail");
+        throw std::runtime_error("Failed to create a timer");
+    }
+
+    struct itimerspec spec = {};
+    spec.it_value.tv_sec = interval / 1000;
+    spec.it_value.tv_nsec = (interval % 1000) * 1000000L;
+    // A zero value disarms the timer
+    if (interval <= 0) {
+        spec.it_value.tv_sec = 0;
+        spec.it_value.tv_nsec = 1;
+    }
+    if (timerfd_settime(fd, 0, &spec, nullptr) == -1) {
+        ERR_CODE(errno, "timerfd_settime() Fail");
+        close(fd);
+        throw std::runtime_error("Failed to set a timer");
+    }
+
+    std::shared_ptr<Source> source = std::make_shared<Source>(cb, data);
+
+    std::lock_guard<std::mutex> lock(sources_lock);
+    do {
+        source->timeout_id = ++next_timeout_id;
+    } while (source->timeout_id == 0 || timeouts.count(source->timeout_id));
+    try {
+        AddSource(fd, source);
+    } catch (std::exception &e) {
+        close(fd);
+        throw;
+    }
+    timeouts.emplace(source->timeout_id, fd);
+
+    return source->timeout_id;
+}
+
+void PosixMainLoop::RemoveTimeout(unsigned int id)
+{
+    std::lock_guard<std::mutex> lock(sources_lock);
+    auto it = timeouts.find(id);
+    if (it == timeouts.end())
+        return;
+
+    int fd = it->second;
+    timeouts.erase(it);
+    auto source = sources.find(fd);
+    if (source != sources.end()) {
+        DeactivateSource(fd, *source->second);
+        sources.erase(source);
+    }
+    close(fd);
+}
+
+// Called with sources_lock
+void PosixMainLoop::AddSource(int fd, const std::shared_ptr<Source> &source)
+{
+    source->serial = ++next_serial;
+    if (source->serial == 0)
+        source->serial = ++next_serial;
+
+    struct epoll_event event = {};
+    event.events = EPOLLIN;
+    event.data.u64 = EventKey(source->serial, fd);
+    if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &event) == -1) {
+        ERR_CODE(errno, "epoll_ctl(%d) Fail", fd);
+        throw std::runtime_error("Failed to add a watch");
+    }
+
+    source->active = true;
+    sources.emplace(fd, source);
+}
+
+// Called with sources_lock
+void PosixMainLoop::DeactivateSource(int fd, Source &source)
+{
+    if (source.active == false)
+        return;
+
+    // It fails if fd is already closed, which has removed it from the epoll set
+    if (epoll_ctl(epoll_fd, EPOLL_CTL_DEL, fd, nullptr) == -1)
+        DBG("epoll_ctl(%d) Fail(%d)", fd, errno);
+    source.active = false;
+}
+
+void PosixMainLoop::Dispatch(uint64_t key, uint32_t events)
+{
+    int fd = static_cast<int>(key & 0xFFFFFFFF);
+    std::shared_ptr<Source> source;
+    {
+        std::lock_guard<std::mutex> lock(sources_lock);
+        auto it = sources.find(fd);
+        // Removed, or replaced by a new source after the event was taken
+        if (it == sources.end() || EventKey(it->second->serial, fd) != key
+              || it->second->active == false)
+            return;
+        source = it->second;
+
+        if (source->timeout_id) {
+            timeouts.erase(source->timeout_id);
+            sources.erase(it);
+            DeactivateSource(fd, *source);
+            close(fd);
+        } else if (events & (EPOLLHUP | EPOLLERR)) {
+            // Like the GLib loop, it is not invoked anymore but stays until RemoveWatch()
+            DeactivateSource(fd, *source);
+        }
+    }
+
+    if (source->timeout_id) {
+        source->cb(OK, -1, source->data);
+        return;
+    }
+
+    MainLoopResult result = OK;
+    if (events & (EPOLLHUP | EPOLLERR)) {
+        ERR("Connection Error(%u)", events);
+        result = (events & EPOLLHUP) ? HANGUP : ERROR;
+    }
+
+    source->cb(result, fd, source->data);
+}
+
+void PosixMainLoop::DispatchIdles(void)
+{
+    uint64_t count;
+    if (read(event_fd, &count, sizeof(count)) == -1 && errno != EAGAIN)
+        ERR_CODE(errno, "read() Fail");
+
+    std::vector<Idle> pending;
+    {
+        std::lock_guard<std::mutex> lock(idles_lock);
+        pending.swap(idles);
+    }
+
+    for (Idle &idle : pending)
+        idle.first(OK, -1, idle.second);
+}
+
+void PosixMainLoop::Wakeup(void)
+{
+    uint64_t count = 1;
+    if (write(event_fd, &count, sizeof(count)) == -1 && errno != EAGAIN)
+        ERR_CODE(errno, "write() Fail");
+}
+
+PosixMainLoop::Source::Source(const mainLoopCB &cb, MainLoopData *data)
+      : cb(cb), data(data), timeout_id(0), serial(0), active(false)
+{
+}
+
+}  // namespace aitt
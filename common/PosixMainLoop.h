@@ -0,0 +1,76 @@
+/*
+ * Copyright (c) 2022 Samsung Electronics Co., Ltd All Rights Reserved
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+
+#include <stdint.h>
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "MainLoopIface.h"
+
+namespace aitt {
+
+// MainLoopIface on epoll, without GLib.
+// An eventfd wakes up the loop for AddIdle() and Quit(), and each timeout is a timerfd.
+class PosixMainLoop : public MainLoopIface {
+  public:
+    PosixMainLoop();
+    ~PosixMainLoop();
+
+    void Run() override;
+    bool Quit() override;
+    void AddIdle(const mainLoopCB &cb, MainLoopData *user_data) override;
+    void AddWatch(int fd, const mainLoopCB &cb, MainLoopData *user_data) override;
+    MainLoopData *RemoveWatch(int fd) override;
+    unsigned int AddTimeout(int interval, const mainLoopCB &cb, MainLoopData *user_data) override;
+    void RemoveTimeout(unsigned int id) override;
+
+  private:
+    // A watched fd, or the timerfd of a timeout
+    struct Source {
+        Source(const mainLoopCB &cb, MainLoopData *data);
+        mainLoopCB cb;
+        MainLoopData *data;
+        unsigned int timeout_id;  // 0 for a watch
+        uint32_t serial;          // tells the source from an older one of the same fd
+        bool active;              // in the epoll set
+    };
+    using Idle = std::pair<mainLoopCB, MainLoopData *>;
+
+    void AddSource(int fd, const std::shared_ptr<Source> &source);
+    void DeactivateSource(int fd, Source &source);
+    void Dispatch(uint64_t key, uint32_t events);
+    void DispatchIdles(void);
+    void Wakeup(void);
+
+    int epoll_fd;
+    int event_fd;
+    std::atomic_bool running;
+    std::unordered_map<int, std::shared_ptr<Source>> sources;  // by fd
+    std::unordered_map<unsigned int, int> timeouts;            // timerfd by id
+    uint32_t next_serial;
+    unsigned int next_timeout_id;
+    std::mutex sources_lock;
+    std::vector<Idle> idles;
+    std::mutex idles_lock;
+};
+
+}  // namespace aitt
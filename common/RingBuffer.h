@@ -0,0 +1,111 @@
+/*
+ * Copyright (c) 2022 Samsung Electronics Co., Ltd All Rights Reserved
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+
+#include <stdint.h>
+
+#include <atomic>
+#include <memory>
+
+namespace aitt {
+
+// Bounded lock-free queue for multiple producers and a single consumer.
+// Each cell carries a sequence number telling whether it is free, claimed or published, so
+// producers only compete on the enqueue position and the consumer never takes a lock.
+template <typename T>
+class RingBuffer {
+  public:
+    // capacity is rounded up to a power of two
+    explicit RingBuffer(size_t capacity);
+
+    // Returns false without touching the item if the buffer is full. (any thread)
+    bool Push(T &&item);
+    // Returns false if there is no published item. (consumer thread only)
+    bool Pop(T &item);
+    size_t Capacity(void) const { return mask + 1; }
+
+  private:
+    struct Cell {
+        std::atomic<size_t> sequence;
+        T data;
+    };
+
+    static size_t RoundUp(size_t capacity);
+
+    const size_t mask;
+    std::unique_ptr<Cell[]> cells;
+    char padding1[64];
+    std::atomic<size_t> enqueue_pos;
+    char padding2[64];
+    size_t dequeue_pos;
+};
+
+template <typename T>
+RingBuffer<T>::RingBuffer(size_t capacity)
+      : mask(RoundUp(capacity) - 1), cells(new Cell[mask + 1]), enqueue_pos(0), dequeue_pos(0)
+{
+    for (size_t i = 0; i <= mask; i++)
+        cells[i].sequence.store(i, std::memory_order_relaxed);
+}
+
+template <typename T>
+size_t RingBuffer<T>::RoundUp(size_t capacity)
+{
+    size_t size = 2;
+    while (size < capacity)
+        size <<= 1;
+    return size;
+}
+
+template <typename T>
+bool RingBuffer<T>::Push(T &&item)
+{
+    Cell *cell;
+    size_t pos = enqueue_pos.load(std::memory_order_relaxed);
+    while (true) {
+        cell = &cells[pos & mask];
+        size_t seq = cell->sequence.load(std::memory_order_acquire);
+        intptr_t diff = (intptr_t)seq - (intptr_t)pos;
+        if (diff == 0) {
+            if (enqueue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                break;
+        } else if (diff < 0) {
+            return false;
+        } else {
+            pos = enqueue_pos.load(std::memory_order_relaxed);
+        }
+    }
+
+    cell->data = std::move(item);
+    cell->sequence.store(pos + 1, std::memory_order_release);
+    return true;
+}
+
+template <typename T>
+bool RingBuffer<T>::Pop(T &item)
+{
+    Cell *cell = &cells[dequeue_pos & mask];
+    size_t seq = cell->sequence.load(std::memory_order_acquire);
+    if ((intptr_t)seq - (intptr_t)(dequeue_pos + 1) < 0)
+        return false;
+
+    item = std::move(cell->data);
+    cell->sequence.store(dequeue_pos + mask + 1, std::memory_order_release);
+    dequeue_pos++;
+    return true;
+}
+
+}  // namespace aitt
@@ -0,0 +1,205 @@
+/*
+ * Copyright (c) 2022 Samsung Electronics Co., Ltd All Rights Reserved
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "ShardedMQ.h"
+
+#include <functional>
+
+#include "AittException.h"
+#include "aitt_internal.h"
+#include "aitt_internal_definitions.h"
+
+// Connection of the requests and of the subscriptions of their replies
+#define REPLY_SHARD 0
+
+namespace aitt {
+
+// Connection delivering the message on this thread, for SharePayload()
+static thread_local MQ *delivering_shard = nullptr;
+
+ShardedMQ::ShardedMQ(std::vector<std::unique_ptr<MQ>> connections)
+      : shards(std::move(connections)),
+        shard_states(shards.size(), AITT_DISCONNECTED),
+        state(AITT_DISCONNECTED)
+{
+    if (shards.empty()) {
+        ERR("No connection");
+        throw AittException(AittException::INVALID_ARG);
+    }
+
+    for (size_t i = 0; i < shards.size(); i++)
+        shards[i]->SetConnectionCallback(
+              std::bind(&ShardedMQ::ConnectionCallback, this, i, std::placeholders::_1));
+}
+
+size_t ShardedMQ::Shard(const std::string &topic) const
+{
+    return std::hash<std::string>()(topic) % shards.size();
+}
+
+// Reply topics of AITT, see AITT::Impl::PublishWithReply(). Those are under REPLY_TOPIC_BASE, or
+// the topic of the request followed by RESPONSE_POSTFIX and a number.
+size_t ShardedMQ::SubscribeShard(const std::string &topic) const
+{
+    if (topic.compare(0, REPLY_TOPIC_BASE.size(), REPLY_TOPIC_BASE) == 0)
+        return REPLY_SHARD;
+
+    const std::string postfix(RESPONSE_POSTFIX);
+    size_t pos = topic.rfind(postfix);
+    if (pos != std::string::npos) {
+        size_t number = pos + postfix.size();
+        if (number < topic.size()
+              && topic.find_first_not_of("0123456789", number) == std::string::npos)
+            return REPLY_SHARD;
+    }
+
+    return Shard(topic);
+}
+
+void ShardedMQ::SetConnectionCallback(const MQConnectionCallback &cb)
+{
+    std::lock_guard<std::mutex> lock(state_lock);
+    connect_cb = cb;
+}
+
+// Connected when every connection is, and disconnected as soon as one of them is.
+void ShardedMQ::ConnectionCallback(size_t index, int status)
+{
+    std::unique_lock<std::mutex> lock(state_lock);
+    shard_states[index] = status;
+
+    int new_state = AITT_CONNECTED;
+    for (int shard_state : shard_states) {
+        if (shard_state == AITT_CONNECT_FAILED) {
+            new_state = AITT_CONNECT_FAILED;
+            break;
+        }
+        if (shard_state == AITT_DISCONNECTED)
+            new_state = AITT_DISCONNECTED;
+    }
+    if (new_state == state)
+        return;
+
+    state = new_state;
+    MQConnectionCallback cb = connect_cb;
+    lock.unlock();
+
+    if (cb)
+        cb(new_state);
+}
+
+void ShardedMQ::SetPublishAckCallback(const PublishAckCallback &cb)
+{
+    for (auto &shard : shards)
+        shard->SetPublishAckCallback(cb);
+}
+
+void ShardedMQ::Connect(const std::string &host, int port, const std::string &username,
+      const std::string &password)
+{
+    for (auto &shard : shards)
+        shard->Connect(host, port, username, password);
+}
+
+// The will is sent once, when the first connection is lost
+void ShardedMQ::SetWillInfo(const std::string &topic, const void *msg, size_t szmsg, int qos,
+      bool retain)
+{
+    shards[0]->SetWillInfo(topic, msg, szmsg, qos, retain);
+}
+
+void ShardedMQ::Disconnect(void)
+{
+    for (auto &shard : shards)
+        shard->Disconnect();
+}
+
+void ShardedMQ::Publish(const std::string &topic, const void *data, const size_t datalen, int qos,
+      bool retain)
+{
+    shards[Shard(topic)]->Publish(topic, data, datalen, qos, retain);
+}
+
+void ShardedMQ::PublishBatch(const std::vector<AittPublishEntry> &entries)
+{
+    std::vector<std::vector<AittPublishEntry>> batches(shards.size());
+    for (const AittPublishEntry &entry : entries)
+        batches[Shard(entry.topic)].push_back(entry);
+
+    for (size_t i = 0; i < shards.size(); i++) {
+        if (batches[i].empty() == false)
+            shards[i]->PublishBatch(batches[i]);
+    }
+}
+
+void ShardedMQ::PublishWithReply(const std::string &topic, const void *data,
+      const size_t datalen, int qos, bool retain, const std::string &reply_topic,
+      const std::string &correlation)
+{
+    // After the subscription of reply_topic on the same connection
+    shards[REPLY_SHARD]->PublishWithReply(topic, data, datalen, qos, retain, reply_topic,
+          correlation);
+}
+
+void ShardedMQ::SendReply(MSG *msg, const void *data, const size_t datalen, int qos, bool retain)
+{
+    RET_IF(msg == nullptr);
+
+    shards[Shard(msg->GetResponseTopic())]->SendReply(msg, data, datalen, qos, retain);
+}
+
+void *ShardedMQ::Subscribe(const std::string &topic, const SubscribeCallback &cb, void *user_data,
+      int qos)
+{
+    size_t index = SubscribeShard(topic);
+    MQ *shard = shards[index].get();
+    void *handle = shard->Subscribe(
+          topic,
+          [shard, cb](MSG *msg, const std::string &msg_topic, const void *data,
+                const size_t datalen, void *cbdata) {
+              MQ *previous = delivering_shard;
+              delivering_shard = shard;
+              cb(msg, msg_topic, data, datalen, cbdata);
+              delivering_shard = previous;
+          },
+          user_data, qos);
+
+    std::lock_guard<std::mutex> lock(subscriptions_lock);
+    return reinterpret_cast<void *>(subscriptions.Insert(Subscription(index, handle)));
+}
+
+void *ShardedMQ::Unsubscribe(void *handle)
+{
+    Subscription subscription;
+    {
+        std::lock_guard<std::mutex> lock(subscriptions_lock);
+        if (subscriptions.Erase(reinterpret_cast<uintptr_t>(handle), &subscription) == false) {
+            ERR("No Subscription(%p)", handle);
+            throw AittException(AittException::NO_DATA_ERR);
+        }
+    }
+
+    return shards[subscription.first]->Unsubscribe(subscription.second);
+}
+
+std::shared_ptr<void> ShardedMQ::SharePayload(const void *data, size_t datalen)
+{
+    if (delivering_shard)
+        return delivering_shard->SharePayload(data, datalen);
+
+    return MQ::SharePayload(data, datalen);
+}
+
+}  // namespace aitt
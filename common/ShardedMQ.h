@@ -0,0 +1,79 @@
+/*
+ * Copyright (c) 2022 Samsung Electronics Co., Ltd All Rights Reserved
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "MQ.h"
+#include "SlotMap.h"
+
+namespace aitt {
+
+// MQ spreading topics over several broker connections, to publish beyond the throughput of a
+// single connection and its network thread.
+// A topic, or a topic filter for Subscribe(), always goes through the same connection chosen by
+// its hash, so messages of a topic keep their order. Callbacks of different connections are
+// invoked on different threads.
+// MQTT orders a SUBSCRIBE before a PUBLISH only within a connection, so PublishWithReply() and
+// the subscriptions of reply topics all go through the first connection instead. A request is
+// then not ordered against a Publish() to the same topic.
+class ShardedMQ : public MQ {
+  public:
+    explicit ShardedMQ(std::vector<std::unique_ptr<MQ>> connections);
+    virtual ~ShardedMQ(void) = default;
+
+    void SetConnectionCallback(const MQConnectionCallback &cb) override;
+    void SetPublishAckCallback(const PublishAckCallback &cb) override;
+    void Connect(const std::string &host, int port, const std::string &username,
+          const std::string &password) override;
+    void SetWillInfo(const std::string &topic, const void *msg, size_t szmsg, int qos,
+          bool retain) override;
+    void Disconnect(void) override;
+    void Publish(const std::string &topic, const void *data, const size_t datalen, int qos = 0,
+          bool retain = false) override;
+    void PublishBatch(const std::vector<AittPublishEntry> &entries) override;
+    void PublishWithReply(const std::string &topic, const void *data, const size_t datalen,
+          int qos, bool retain, const std::string &reply_topic,
+          const std::string &correlation) override;
+    void SendReply(MSG *msg, const void *data, const size_t datalen, int qos,
+          bool retain) override;
+    void *Subscribe(const std::string &topic, const SubscribeCallback &cb,
+          void *user_data = nullptr, int qos = 0) override;
+    void *Unsubscribe(void *handle) override;
+    std::shared_ptr<void> SharePayload(const void *data, size_t datalen) override;
+
+  private:
+    // connection index, handle of the connection
+    using Subscription = std::pair<size_t, void *>;
+
+    size_t Shard(const std::string &topic) const;
+    size_t SubscribeShard(const std::string &topic) const;
+    void ConnectionCallback(size_t index, int status);
+
+    std::vector<std::unique_ptr<MQ>> shards;
+    SlotMap<Subscription> subscriptions;
+    std::mutex subscriptions_lock;
+    std::vector<int> shard_states;
+    int state;  // AittConnectionState of all connections together
+    MQConnectionCallback connect_cb;
+    std::mutex state_lock;
+};
+
+}  // namespace aitt
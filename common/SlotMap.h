@@ -0,0 +1,149 @@
+/*
+ * Copyright (c) 2022 Samsung Electronics Co., Ltd All Rights Reserved
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+namespace aitt {
+
+// Container handing out opaque handles with O(1) lookup and removal.
+// A handle packs the slot index and the generation of the slot, and the generation changes
+// whenever the slot is released. So a stale handle, or a value which was never returned by
+// Insert(), is rejected instead of reaching another value. 0 is never a valid handle.
+// Each takes half of the handle, so Insert() throws std::length_error beyond 65535 values on
+// 32-bit targets. Not thread safe.
+template <typename T>
+class SlotMap {
+  public:
+    using Handle = uintptr_t;
+
+    SlotMap(void) : count(0) {}
+
+    Handle Insert(T value);
+    T *Get(Handle handle);
+    bool Erase(Handle handle, T *value = nullptr);
+    void Clear(void);
+    size_t Size(void) const { return count; }
+
+    template <typename Func>
+    void ForEach(Func func);
+
+  private:
+    static constexpr int INDEX_BITS = sizeof(Handle) * 4;
+    static constexpr Handle INDEX_MASK = (static_cast<Handle>(1) << INDEX_BITS) - 1;
+    static constexpr int GENERATION_BITS = sizeof(Handle) * 8 - INDEX_BITS;
+    static constexpr Handle GENERATION_MASK = (static_cast<Handle>(1) << GENERATION_BITS) - 1;
+
+    struct Slot {
+        T value;
+        Handle generation;
+        bool used;
+    };
+
+    Slot *Find(Handle handle);
+
+    std::vector<Slot> slots;
+    std::vector<size_t> free_slots;
+    size_t count;
+};
+
+template <typename T>
+typename SlotMap<T>::Handle SlotMap<T>::Insert(T value)
+{
+    size_t index;
+    if (free_slots.empty()) {
+        index = slots.size();
+        if (INDEX_MASK < index + 1)
+            throw std::length_error("Too many values in SlotMap");
+        slots.push_back(Slot{T(), 0, false});
+    } else {
+        index = free_slots.back();
+        free_slots.pop_back();
+    }
+
+    Slot &slot = slots[index];
+    slot.value = std::move(value);
+    slot.used = true;
+    count++;
+
+    // index + 1, so that the handle is never 0
+    return (slot.generation << INDEX_BITS) | (index + 1);
+}
+
+template <typename T>
+typename SlotMap<T>::Slot *SlotMap<T>::Find(Handle handle)
+{
+    Handle index = handle & INDEX_MASK;
+    if (index == 0 || slots.size() < index)
+        return nullptr;
+
+    Slot &slot = slots[index - 1];
+    if (slot.used == false || slot.generation != (handle >> INDEX_BITS))
+        return nullptr;
+
+    return &slot;
+}
+
+template <typename T>
+T *SlotMap<T>::Get(Handle handle)
+{
+    Slot *slot = Find(handle);
+    return slot ? &slot->value : nullptr;
+}
+
+template <typename T>
+bool SlotMap<T>::Erase(Handle handle, T *value)
+{
+    Slot *slot = Find(handle);
+    if (slot == nullptr)
+        return false;
+
+    if (value)
+        *value = std::move(slot->value);
+    slot->value = T();
+    slot->used = false;
+    slot->generation = (slot->generation + 1) & GENERATION_MASK;
+    free_slots.push_back(slot - slots.data());
+    count--;
+
+    return true;
+}
+
+template <typename T>
+void SlotMap<T>::Clear(void)
+{
+    for (size_t i = 0; i < slots.size(); i++) {
+        if (slots[i].used)
+            Erase((slots[i].generation << INDEX_BITS) | (i + 1));
+    }
+}
+
+template <typename T>
+template <typename Func>
+void SlotMap<T>::ForEach(Func func)
+{
+    for (Slot &slot : slots) {
+        if (slot.used)
+            func(slot.value);
+    }
+}
+
+}  // namespace aitt
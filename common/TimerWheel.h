@@ -0,0 +1,244 @@
+/*
+ * Copyright (c) 2022 Samsung Electronics Co., Ltd All Rights Reserved
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+
+#include <stdint.h>
+
+#include <limits>
+#include <utility>
+#include <vector>
+
+#include "SlotMap.h"
+
+namespace aitt {
+
+// Hierarchical timer wheel with O(1) Add(), Rearm() and Remove().
+// Time is counted in ticks given by the caller. Level 0 has a slot per tick and each higher
+// level has a slot per lap of the level below, so a timer sits in the level matching how far it
+// is and moves down (cascades) when the level below reaches its slot. Timers further than the
+// last level are parked in it and placed again when it cascades.
+// Handles are the ones of a SlotMap, so a stale handle is rejected. Not thread safe.
+template <typename T>
+class TimerWheel {
+  public:
+    using Handle = uintptr_t;
+    static constexpr uint64_t NEVER = std::numeric_limits<uint64_t>::max();
+
+    explicit TimerWheel(uint64_t now = 0);
+
+    Handle Add(uint64_t expires, T value);
+    bool Rearm(Handle handle, uint64_t expires);
+    bool Remove(Handle handle, T *value = nullptr);
+    // Moves the values of the timers expired by now to expired, in the order of their ticks
+    void Expire(uint64_t now, std::vector<T> &expired);
+    // Earliest tick to call Expire() at, which may be before the next expiration when timers
+    // have to cascade first. NEVER if there is no timer.
+    uint64_t NextTick(void) const;
+    size_t Size(void) const { return timers.Size(); }
+
+  private:
+    static constexpr int LEVELS = 4;
+    static constexpr int SLOT_BITS = 6;
+    static constexpr int SLOTS = 1 << SLOT_BITS;
+    static constexpr uint64_t SLOT_MASK = SLOTS - 1;
+    static constexpr uint64_t MAX_DELTA = (static_cast<uint64_t>(1) << (LEVELS * SLOT_BITS)) - 1;
+
+    struct Timer {
+        T value;
+        uint64_t expires;
+        Handle prev;
+        Handle next;
+        int level;
+        int slot;
+    };
+
+    void Link(Handle handle, Timer &timer);
+    void Unlink(Timer &timer);
+    void Cascade(int level);
+
+    SlotMap<Timer> timers;
+    Handle heads[LEVELS][SLOTS];
+    uint64_t occupied[LEVELS];  // bitmap of non-empty slots
+    uint64_t current;           // next tick to process
+};
+
+template <typename T>
+constexpr uint64_t TimerWheel<T>::NEVER;
+
+template <typename T>
+TimerWheel<T>::TimerWheel(uint64_t now) : heads(), occupied(), current(now)
+{
+}
+
+template <typename T>
+typename TimerWheel<T>::Handle TimerWheel<T>::Add(uint64_t expires, T value)
+{
+    Handle handle = timers.Insert(Timer{std::move(value), expires, 0, 0, 0, 0});
+    Link(handle, *timers.Get(handle));
+    return handle;
+}
+
+template <typename T>
+bool TimerWheel<T>::Rearm(Handle handle, uint64_t expires)
+{
+    Timer *timer = timers.Get(handle);
+    if (timer == nullptr)
+        return false;
+
+    Unlink(*timer);
+    timer->expires = expires;
+    Link(handle, *timer);
+    return true;
+}
+
+template <typename T>
+bool TimerWheel<T>::Remove(Handle handle, T *value)
+{
+    Timer *timer = timers.Get(handle);
+    if (timer == nullptr)
+        return false;
+
+    Unlink(*timer);
+    Timer removed;
+    timers.Erase(handle, &removed);
+    if (value)
+        *value = std::move(removed.value);
+    return true;
+}
+
+template <typename T>
+void TimerWheel<T>::Link(Handle handle, Timer &timer)
+{
+    uint64_t slot_time = timer.expires;
+    if (slot_time < current)
+        slot_time = current;
+    else if (MAX_DELTA < slot_time - current)
+        slot_time = current + MAX_DELTA;
+
+    uint64_t delta = slot_time - current;
+    int level = 0;
+    while (level < LEVELS - 1 && (delta >> (SLOT_BITS * (level + 1))) != 0)
+        level++;
+
+    timer.level = level;
+    timer.slot = (slot_time >> (SLOT_BITS * level)) & SLOT_MASK;
+    timer.prev = 0;
+    timer.next = heads[level][timer.slot];
+    if (timer.next)
+        timers.Get(timer.next)->prev = handle;
+    heads[level][timer.slot] = handle;
+    occupied[level] |= static_cast<uint64_t>(1) << timer.slot;
+}
+
+template <typename T>
+void TimerWheel<T>::Unlink(Timer &timer)
+{
+    if (timer.prev)
+        timers.Get(timer.prev)->next = timer.next;
+    else
+        heads[timer.level][timer.slot] = timer.next;
+
+    if (timer.next)
+        timers.Get(timer.next)->prev = timer.prev;
+
+    if (heads[timer.level][timer.slot] == 0)
+        occupied[timer.level] &= ~(static_cast<uint64_t>(1) << timer.slot);
+}
+
+// Places the timers of the current slot of the level again, into lower levels
+template <typename T>
+void TimerWheel<T>::Cascade(int level)
+{
+    int slot = (current >> (SLOT_BITS * level)) & SLOT_MASK;
+    Handle handle = heads[level][slot];
+    heads[level][slot] = 0;
+    occupied[level] &= ~(static_cast<uint64_t>(1) << slot);
+
+    while (handle) {
+        Timer *timer = timers.Get(handle);
+        Handle next = timer->next;
+        Link(handle, *timer);
+        handle = next;
+    }
+}
+
+template <typename T>
+void TimerWheel<T>::Expire(uint64_t now, std::vector<T> &expired)
+{
+    while (current <= now) {
+        if (timers.Size() == 0) {
+            current = now + 1;
+            break;
+        }
+
+        int slot = current & SLOT_MASK;
+        if (slot == 0) {
+            for (int level = 1; level < LEVELS; level++) {
+                Cascade(level);
+                if (((current >> (SLOT_BITS * level)) & SLOT_MASK) != 0)
+                    break;
+            }
+        }
+
+        // Nothing until the next lap of level 0, which cascades
+        if (occupied[0] == 0) {
+            uint64_t lap = (current | SLOT_MASK) + 1;
+            current = (now < lap) ? now + 1 : lap;
+            continue;
+        }
+
+        Handle handle = heads[0][slot];
+        heads[0][slot] = 0;
+        occupied[0] &= ~(static_cast<uint64_t>(1) << slot);
+        while (handle) {
+            Timer removed;
+            timers.Erase(handle, &removed);
+            expired.push_back(std::move(removed.value));
+            handle = removed.next;
+        }
+        current++;
+    }
+}
+
+template <typename T>
+uint64_t TimerWheel<T>::NextTick(void) const
+{
+    if (timers.Size() == 0)
+        return NEVER;
+
+    uint64_t next = NEVER;
+    for (int level = 0; level < LEVELS; level++) {
+        if (occupied[level] == 0)
+            continue;
+
+        // Slots of the level are processed on ticks which are multiples of its slot width
+        int shift = SLOT_BITS * level;
+        uint64_t first = ((current + (static_cast<uint64_t>(1) << shift) - 1) >> shift) << shift;
+        int position = (first >> shift) & SLOT_MASK;
+        uint64_t rotated = (occupied[level] >> position);
+        if (position)
+            rotated |= occupied[level] << (SLOTS - position);
+
+        uint64_t distance = __builtin_ctzll(rotated);
+        uint64_t tick = first + (distance << shift);
+        if (tick < next)
+            next = tick;
+    }
+
+    return next;
+}
+
+}  // namespace aitt
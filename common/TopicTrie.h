@@ -0,0 +1,192 @@
+/*
+ * Copyright (c) 2022 Samsung Electronics Co., Ltd All Rights Reserved
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+
+#include <algorithm>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace aitt {
+
+// Index of MQTT topic filters split by level.
+// Match() only walks the branches that can match a topic, so the cost depends on the depth of
+// the topic instead of the number of filters. '+' and '#' follow the MQTT matching rules,
+// including that wildcards at the first level do not match topics starting with '$'.
+template <typename T>
+class TopicTrie {
+  public:
+    TopicTrie(void) = default;
+
+    void Insert(const std::string &filter, const T &value);
+    bool Remove(const std::string &filter, const T &value);
+    void Match(const std::string &topic, std::vector<T> &result) const;
+    bool Empty(void) const { return root.IsEmpty(); }
+
+  private:
+    struct Node {
+        bool IsEmpty(void) const
+        {
+            return values.empty() && children.empty() && single_level == nullptr
+                   && multi_level == nullptr;
+        }
+
+        std::unordered_map<std::string, std::unique_ptr<Node>> children;
+        std::unique_ptr<Node> single_level;  // '+'
+        std::unique_ptr<Node> multi_level;   // '#'
+        std::vector<T> values;
+    };
+
+    static size_t NextLevel(const std::string &str, size_t pos, std::string &level);
+    static std::unique_ptr<Node> &Child(Node *node, const std::string &level);
+    static bool RemoveNode(Node *node, const std::string &filter, size_t pos, const T &value);
+    static void MatchNode(const Node *node, const std::string &topic, size_t pos, bool first,
+          std::vector<T> &result);
+
+    Node root;
+};
+
+// Copies the level starting at pos into 'level' and returns the position of the next level,
+// or std::string::npos if it was the last one.
+template <typename T>
+size_t TopicTrie<T>::NextLevel(const std::string &str, size_t pos, std::string &level)
+{
+    size_t end = str.find('/', pos);
+    if (end == std::string::npos) {
+        level.assign(str, pos, std::string::npos);
+        return std::string::npos;
+    }
+
+    level.assign(str, pos, end - pos);
+    return end + 1;
+}
+
+template <typename T>
+std::unique_ptr<typename TopicTrie<T>::Node> &TopicTrie<T>::Child(Node *node,
+      const std::string &level)
+{
+    if (level == "+")
+        return node->single_level;
+    if (level == "#")
+        return node->multi_level;
+    return node->children[level];
+}
+
+template <typename T>
+void TopicTrie<T>::Insert(const std::string &filter, const T &value)
+{
+    Node *node = &root;
+    std::string level;
+    size_t pos = 0;
+
+    do {
+        pos = NextLevel(filter, pos, level);
+        std::unique_ptr<Node> &child = Child(node, level);
+        if (child == nullptr)
+            child.reset(new Node());
+        node = child.get();
+    } while (pos != std::string::npos);
+
+    node->values.push_back(value);
+}
+
+template <typename T>
+bool TopicTrie<T>::Remove(const std::string &filter, const T &value)
+{
+    return RemoveNode(&root, filter, 0, value);
+}
+
+template <typename T>
+bool TopicTrie<T>::RemoveNode(Node *node, const std::string &filter, size_t pos, const T &value)
+{
+    std::string level;
+    size_t next = NextLevel(filter, pos, level);
+
+    std::unique_ptr<Node> *child;
+    if (level == "+") {
+        child = &node->single_level;
+    } else if (level == "#") {
+        child = &node->multi_level;
+    } else {
+        auto it = node->children.find(level);
+        if (it == node->children.end())
+            return false;
+        child = &it->second;
+    }
+
+    if (*child == nullptr)
+        return false;
+
+    bool found;
+    if (next == std::string::npos) {
+        std::vector<T> &values = (*child)->values;
+        auto it = std::find(values.begin(), values.end(), value);
+        found = (it != values.end());
+        if (found)
+            values.erase(it);
+    } else {
+        found = RemoveNode(child->get(), filter, next, value);
+    }
+
+    if (found && (*child)->IsEmpty()) {
+        if (child == &node->single_level || child == &node->multi_level)
+            child->reset();
+        else
+            node->children.erase(level);
+    }
+
+    return found;
+}
+
+template <typename T>
+void TopicTrie<T>::Match(const std::string &topic, std::vector<T> &result) const
+{
+    MatchNode(&root, topic, 0, true, result);
+}
+
+// 'pos' is the beginning of the topic level to be matched at 'node', or std::string::npos
+// when every level of the topic has been consumed.
+template <typename T>
+void TopicTrie<T>::MatchNode(const Node *node, const std::string &topic, size_t pos, bool first,
+      std::vector<T> &result)
+{
+    bool system_topic = first && topic[0] == '$';
+
+    // "a/#" also matches "a"
+    if (node->multi_level && !system_topic)
+        result.insert(result.end(), node->multi_level->values.begin(),
+              node->multi_level->values.end());
+
+    if (pos == std::string::npos) {
+        result.insert(result.end(), node->values.begin(), node->values.end());
+        return;
+    }
+
+    std::string level;
+    size_t next = NextLevel(topic, pos, level);
+
+    if (node->children.empty() == false) {
+        auto it = node->children.find(level);
+        if (it != node->children.end())
+            MatchNode(it->second.get(), topic, next, false, result);
+    }
+
+    if (node->single_level && !system_topic)
+        MatchNode(node->single_level.get(), topic, next, false, result);
+}
+
+}  // namespace aitt
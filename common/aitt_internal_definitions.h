@@ -25,6 +25,7 @@
 #define AITT_MANAGED_TOPIC_PREFIX "/v1/custom/aitt/"
 #define DISCOVERY_TOPIC_BASE std::string(AITT_MANAGED_TOPIC_PREFIX "discovery/")
 #define RESPONSE_POSTFIX "_AittRe_"
+#define REPLY_TOPIC_BASE std::string(AITT_MANAGED_TOPIC_PREFIX "reply/")
 
 // Specification MQTT-4.7.3-3
 #define AITT_TOPIC_NAME_MAX 65535
@@ -21,8 +21,10 @@
 #include <MSG.h>
 
 #include <functional>
+#include <future>
 #include <memory>
 #include <string>
+#include <vector>
 
 #define AITT_LOCALHOST "127.0.0.1"
 #define AITT_PORT 1883
@@ -34,6 +36,15 @@ class API AITT {
     using SubscribeCallback =
           std::function<void(MSG *msg, const void *data, const size_t datalen, void *user_data)>;
     using ConnectionCallback = std::function<void(AITT &, int, void *user_data)>;
+    // result is the MQTT reason code of the acknowledgement, 0 on success
+    using PublishAckCallback =
+          std::function<void(AITT &, const std::string &topic, int result, void *user_data)>;
+
+    // A part of the reply to PublishWithReplyAsync()
+    struct Reply {
+        MSG msg;
+        std::vector<char> data;
+    };
 
     explicit AITT(const std::string &id, const std::string &ip_addr,
           AittOption option = AittOption(false, false));
@@ -42,6 +53,12 @@ class API AITT {
     void SetWillInfo(const std::string &topic, const void *data, const size_t datalen, AittQoS qos,
           bool retain);
     void SetConnectionCallback(ConnectionCallback cb, void *user_data = nullptr);
+    // Called on the MQTT network thread when a QoS 1 or 2 message published through the MQTT is
+    // acknowledged. With AittOption::SetMaxQueued(), Publish() throws
+    // AittException(WOULD_BLOCK_ERR) while the limit is reached, and this tells when to retry.
+    void SetPublishAckCallback(PublishAckCallback cb, void *user_data = nullptr);
+    // Returns without waiting for the broker. The connection callback tells when it is connected,
+    // and the connection is made again with the subscriptions whenever it is lost.
     void Connect(const std::string &host = AITT_LOCALHOST, int port = AITT_PORT,
           const std::string &username = std::string(), const std::string &password = std::string());
     void Disconnect(void);
@@ -49,6 +66,11 @@ class API AITT {
     void Publish(const std::string &topic, const void *data, const size_t datalen,
           AittProtocol protocols = AITT_TYPE_MQTT, AittQoS qos = AITT_QOS_AT_MOST_ONCE,
           bool retain = false);
+    // Publishes the messages together, so that they are flushed to the network at once.
+    // The messages are sent in order, but they are not atomic. If it throws, some of them may
+    // have been sent.
+    void PublishBatch(const std::vector<AittPublishEntry> &entries,
+          AittProtocol protocols = AITT_TYPE_MQTT);
     int PublishWithReply(const std::string &topic, const void *data, const size_t datalen,
           AittProtocol protocol, AittQoS qos, bool retain, const SubscribeCallback &cb,
           void *cbdata, const std::string &correlation);
@@ -56,10 +78,29 @@ class API AITT {
     int PublishWithReplySync(const std::string &topic, const void *data, const size_t datalen,
           AittProtocol protocol, AittQoS qos, bool retain, const SubscribeCallback &cb,
           void *cbdata, const std::string &correlation, int timeout_ms = 0);
+    // Returns without waiting for the reply, so that many requests can be in flight from one
+    // thread. The future gets every part of the reply once the last one arrives, or throws
+    // AittException(TIMED_OUT_ERR) if the reply is not complete within timeout_ms.
+    // Only AITT_TYPE_MQTT is supported.
+    std::future<std::vector<Reply>> PublishWithReplyAsync(const std::string &topic,
+          const void *data, const size_t datalen, AittProtocol protocol = AITT_TYPE_MQTT,
+          AittQoS qos = AITT_QOS_AT_MOST_ONCE, const std::string &correlation = std::string(),
+          int timeout_ms = 0);
 
+    // flags is a combination of AittSubscribeFlag.
+    // Callbacks are invoked on the AITT worker thread, in the order messages are received.
+    // With AITT_SUBSCRIBE_INLINE, the callback is invoked directly on the MQTT network thread,
+    // which skips the hand-over to the worker thread. In that case:
+    //  - The callback runs concurrently with the worker thread callbacks.
+    //  - No other message of the connection is received until it returns, so it must not block.
+    //  - Only Publish() and SendReply() may be called from it. Subscribe(), Unsubscribe(),
+    //    PublishWithReply(), PublishWithReplySync() and Disconnect() may deadlock.
+    // With AITT_SUBSCRIBE_HIGH_PRIORITY, messages of the subscription are delivered ahead of the
+    // ones of other subscriptions waiting on the same worker thread, up to 8 for each of them, so
+    // that control messages are not held back by a backlog of bulk messages.
     AittSubscribeID Subscribe(const std::string &topic, const SubscribeCallback &cb,
           void *cbdata = nullptr, AittProtocol protocol = AITT_TYPE_MQTT,
-          AittQoS qos = AITT_QOS_AT_MOST_ONCE);
+          AittQoS qos = AITT_QOS_AT_MOST_ONCE, int flags = AITT_SUBSCRIBE_DEFAULT);
     void *Unsubscribe(AittSubscribeID handle);
 
     void SendReply(MSG *msg, const void *data, const size_t datalen, bool end = true);
@@ -30,6 +30,8 @@ class AittException : public std::exception {
         SYSTEM_ERR,
         MQTT_ERR,
         NO_DATA_ERR,
+        TIMED_OUT_ERR,
+        WOULD_BLOCK_ERR,
     };
 
     AittException(ErrCode err_code);
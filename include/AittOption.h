@@ -37,6 +37,44 @@ class API AittOption {
     const char *GetRootCA() const;
     void SetCustomRWFile(const std::string &file);
     const char *GetCustomRWFile() const;
+    // Number of threads invoking subscribe callbacks (default: 1). Callbacks of a subscription
+    // are always invoked on the same thread, but different subscriptions may run in parallel.
+    void SetCallbackThreads(int count);
+    int GetCallbackThreads() const;
+    // Receive the replies of PublishWithReply() through a single subscription per AITT instance
+    // instead of subscribing to a new reply topic for each request.
+    void SetMultiplexReply(bool val);
+    bool GetMultiplexReply() const;
+    // Send the sequence of replies as string user properties, and do not ask responders for the
+    // binary reply header. Without it, the header is used only for requests of peers which
+    // asked for it. Replies in both formats are always received.
+    void SetLegacyReplyFormat(bool val);
+    bool GetLegacyReplyFormat() const;
+    // Maximum number of QoS 1 and 2 messages sent to the broker and not acknowledged yet
+    // (default: 0, the library default). The others wait in the client until acknowledgements
+    // come.
+    void SetMaxInflight(int count);
+    int GetMaxInflight() const;
+    // Maximum number of QoS 1 and 2 messages published and not acknowledged yet, including the
+    // waiting ones (default: 0, unlimited). Publishing more throws
+    // AittException(WOULD_BLOCK_ERR) instead of queueing the message.
+    void SetMaxQueued(int count);
+    int GetMaxQueued() const;
+    // Number of connections to the MQTT broker (default: 1). Topics are spread over them by
+    // hash, and the messages of a topic keep their order. It does not apply to a custom broker.
+    // Requests of PublishWithReply() all go through one connection, together with the
+    // subscriptions of their replies, so they are not ordered against Publish() to the topic.
+    void SetMQConnections(int count);
+    int GetMQConnections() const;
+    // Run the discovery over the data connection instead of a connection of its own. The will of
+    // the connection is then used by the discovery, and AITT::SetWillInfo() is not available.
+    void SetSharedDiscovery(bool val);
+    bool GetSharedDiscovery() const;
+    // Number of threads receiving the messages of TCP subscriptions (default: 1). Connections of
+    // publishers are spread over them, and the messages of a connection keep their order, but
+    // the callback of a subscription may run on several threads at once.
+    void SetTCPReactorThreads(int count);
+    int GetTCPReactorThreads() const;
 
   private:
     bool clear_session_;
@@ -45,4 +83,12 @@ class API AittOption {
     std::string location_id;
     std::string root_ca;
     std::string custom_rw_file;
+    int callback_threads;
+    bool multiplex_reply;
+    bool legacy_reply_format;
+    int max_inflight;
+    int max_queued;
+    int mq_connections;
+    bool shared_discovery;
+    int tcp_reactor_threads;
 };
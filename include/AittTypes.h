@@ -15,6 +15,8 @@
  */
 #pragma once
 
+#include <stddef.h>
+
 #define API __attribute__((visibility("default")))
 
 typedef void* AittSubscribeID;
@@ -34,6 +36,22 @@ enum AittQoS {
     AITT_QOS_EXACTLY_ONCE = 2,   // Receiver only receives exactly once
 };
 
+// AittSubscribeFlag only works with the AITT_TYPE_MQTT
+enum AittSubscribeFlag {
+    AITT_SUBSCRIBE_DEFAULT = 0,
+    AITT_SUBSCRIBE_ZERO_COPY = (0x1 << 0),      // Deliver the received buffer without copying it
+    AITT_SUBSCRIBE_INLINE = (0x1 << 1),         // Invoke the callback on the MQTT network thread
+    AITT_SUBSCRIBE_HIGH_PRIORITY = (0x1 << 2),  // Invoke the callback ahead of the others
+};
+
+// A message of a batch publish. The topic and the data are not copied.
+typedef struct {
+    const char *topic;
+    const void *data;
+    size_t datalen;
+    enum AittQoS qos;
+} AittPublishEntry;
+
 enum AittConnectionState {
     AITT_DISCONNECTED = 0,    // The connection is disconnected.
     AITT_CONNECTED = 1,       // A connection was successfully established to the mqtt broker.
@@ -53,6 +71,7 @@ enum AittConnectionState {
 #define TIZEN_ERROR_INVALID_PARAMETER -EINVAL
 #define TIZEN_ERROR_PERMISSION_DENIED -EACCES
 #define TIZEN_ERROR_OUT_OF_MEMORY -ENOMEM
+#define TIZEN_ERROR_TRY_AGAIN -EAGAIN
 #define TIZEN_ERROR_TIMED_OUT (-1073741824LL + 1)
 #define TIZEN_ERROR_NOT_SUPPORTED (-1073741824LL + 2)
 #define TIZEN_ERROR_AITT -0x04020000
@@ -65,6 +84,7 @@ enum AittError {
     AITT_ERROR_OUT_OF_MEMORY = TIZEN_ERROR_OUT_OF_MEMORY,         /**< Out of memory */
     AITT_ERROR_TIMED_OUT = TIZEN_ERROR_TIMED_OUT,                 /**< Time out */
     AITT_ERROR_NOT_SUPPORTED = TIZEN_ERROR_NOT_SUPPORTED,         /**< Not supported */
+    AITT_ERROR_WOULD_BLOCK = TIZEN_ERROR_TRY_AGAIN,               /**< Too many pending messages */
     AITT_ERROR_UNKNOWN = TIZEN_ERROR_AITT | 0x01,                 /**< Unknown Error */
     AITT_ERROR_SYSTEM = TIZEN_ERROR_AITT | 0x02,                  /**< System errors */
     AITT_ERROR_NOT_READY = TIZEN_ERROR_AITT | 0x03,               /**< System errors */
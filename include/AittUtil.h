@@ -16,6 +16,7 @@
 #pragma once
 
 #include <string>
+#include <vector>
 
 namespace aitt {
 
@@ -25,6 +26,29 @@ class AittUtil {
     ~AittUtil() = default;
 
     static bool CompareTopic(const std::string &left, const std::string &right);
+
+    // MQTT topic filter split into levels once, to be matched against many topics.
+    // A filter without wildcards is matched by a string comparison. An invalid filter is
+    // reported on construction and matches nothing.
+    class TopicFilter {
+      public:
+        explicit TopicFilter(const std::string &filter);
+
+        bool Match(const std::string &topic) const;
+        // For a topic which is not a std::string already, not to copy it
+        bool Match(const char *topic, size_t length) const;
+        const std::string &GetFilter(void) const { return filter; }
+
+      private:
+        struct Level {
+            enum Type { NAME, SINGLE, MULTI } type;  // NAME, '+' or '#'
+            std::string name;
+        };
+
+        std::string filter;
+        std::vector<Level> levels;  // empty if the filter has no wildcard
+        bool valid;
+    };
 };
 
 }  // namespace aitt
@@ -18,8 +18,12 @@
 #include <AittOption.h>
 #include <MSG.h>
 
+#include <cstdlib>
+#include <cstring>
 #include <functional>
+#include <memory>
 #include <string>
+#include <vector>
 
 #define AITT_MQ_NEW aitt_mq_new
 #define TO_STR(s) #s
@@ -34,6 +38,8 @@ class MQ {
     using SubscribeCallback = std::function<void(MSG *msg, const std::string &topic,
           const void *data, const size_t datalen, void *user_data)>;
     using MQConnectionCallback = std::function<void(int)>;
+    // result is the reason code of the acknowledgement, 0 on success
+    using PublishAckCallback = std::function<void(const std::string &topic, int result)>;
 
     static constexpr const char *const MODULE_ENTRY_NAME = DEFINE_TO_STR(AITT_MQ_NEW);
 
@@ -41,6 +47,8 @@ class MQ {
     virtual ~MQ() = default;
 
     virtual void SetConnectionCallback(const MQConnectionCallback &cb) = 0;
+    // Called when a QoS 1 or 2 message is acknowledged. Not supported by default.
+    virtual void SetPublishAckCallback(const PublishAckCallback &cb) {}
     virtual void Connect(const std::string &host, int port, const std::string &username,
           const std::string &password) = 0;
     virtual void SetWillInfo(const std::string &topic, const void *msg, size_t szmsg, int qos,
@@ -48,6 +56,12 @@ class MQ {
     virtual void Disconnect(void) = 0;
     virtual void Publish(const std::string &topic, const void *data, const size_t datalen,
           int qos = 0, bool retain = false) = 0;
+    // The default implementation publishes the entries one by one
+    virtual void PublishBatch(const std::vector<AittPublishEntry> &entries)
+    {
+        for (const AittPublishEntry &entry : entries)
+            Publish(entry.topic, entry.data, entry.datalen, entry.qos);
+    }
     virtual void PublishWithReply(const std::string &topic, const void *data, const size_t datalen,
           int qos, bool retain, const std::string &reply_topic, const std::string &correlation) = 0;
     virtual void SendReply(MSG *msg, const void *data, const size_t datalen, int qos,
@@ -55,6 +69,18 @@ class MQ {
     virtual void *Subscribe(const std::string &topic, const SubscribeCallback &cb,
           void *user_data = nullptr, int qos = 0) = 0;
     virtual void *Unsubscribe(void *handle) = 0;
+
+    // Returns a reference-counted buffer with the data given to a SubscribeCallback, to use it
+    // after the callback returns. The default implementation makes a copy.
+    virtual std::shared_ptr<void> SharePayload(const void *data, size_t datalen)
+    {
+        void *copy = malloc(datalen);
+        if (copy == nullptr)
+            return nullptr;
+
+        memcpy(copy, data, datalen);
+        return std::shared_ptr<void>(copy, free);
+    }
 };
 
 }  // namespace aitt
@@ -39,6 +39,8 @@ class API MSG {
     bool IsEndSequence();
     void SetProtocols(AittProtocol protocols);
     AittProtocol GetProtocols();
+    void SetReplyHeaderAccepted(bool accepted);
+    bool IsReplyHeaderAccepted();
 
   protected:
     std::string topic_;
@@ -48,5 +50,6 @@ class API MSG {
     bool end_sequence;
     AittSubscribeID id_;
     AittProtocol protocols_;
+    bool reply_header_accepted;
 };
 }  // namespace aitt
@@ -63,6 +63,12 @@ typedef enum AittProtocol aitt_protocol_e;
  */
 typedef enum AittQoS aitt_qos_e;
 
+/**
+ * @brief @a aitt_publish_entry_s is a message to publish with aitt_publish_batch().
+ * @see aitt_publish_batch()
+ */
+typedef AittPublishEntry aitt_publish_entry_s;
+
 /**
  * @brief Enumeration for AITT error code.
  */
@@ -255,11 +261,29 @@ int aitt_publish(aitt_h handle, const char *topic, const void *msg, const size_t
  *         otherwise a negative error value
  * @retval #AITT_ERROR_NONE  Success
  * @retval #AITT_ERROR_INVALID_PARAMETER Invalid parameter
+ * @retval #AITT_ERROR_WOULD_BLOCK Too many QoS 1 and 2 messages are not acknowledged yet
  * @retval #AITT_ERROR_SYSTEM System errors
  */
 int aitt_publish_full(aitt_h handle, const char *topic, const void *msg, const size_t msg_len,
       int protocols, aitt_qos_e qos);
 
+/**
+ * @brief Publish messages together, flushing them at once instead of one by one.
+ * @privlevel public
+ * @param[in] handle Handle of AITT service
+ * @param[in] entries array of the messages to send. Each message has its own topic and qos.
+ * @param[in] count the number of @c entries.
+ * @param[in] protocols value of @a aitt_protocol_e. The value can be bitwise-or'd.
+ * @return @c 0 on success
+ *         otherwise a negative error value
+ * @retval #AITT_ERROR_NONE  Success
+ * @retval #AITT_ERROR_INVALID_PARAMETER Invalid parameter
+ * @retval #AITT_ERROR_WOULD_BLOCK Too many QoS 1 and 2 messages are not acknowledged yet
+ * @retval #AITT_ERROR_SYSTEM System errors
+ */
+int aitt_publish_batch(aitt_h handle, const aitt_publish_entry_s *entries, size_t count,
+      int protocols);
+
 /**
  * @brief Publish a message on a given topic as aitt_publish_full(),
  *        but takes reply topic and callback for the reply.
@@ -34,14 +34,23 @@ class MQTTMock {
     MOCK_METHOD6(mosquitto_will_set, int(struct mosquitto *mosq, const char *topic, int payloadlen,
                                            const void *payload, int qos, bool retain));
     MOCK_METHOD1(mosquitto_will_clear, int(struct mosquitto *mosq));
-    MOCK_METHOD4(mosquitto_connect,
+    MOCK_METHOD4(mosquitto_connect_async,
           int(struct mosquitto *mosq, const char *host, int port, int keepalive));
+    MOCK_METHOD4(mosquitto_reconnect_delay_set,
+          int(struct mosquitto *mosq, unsigned int reconnect_delay,
+                unsigned int reconnect_delay_max, bool reconnect_exponential_backoff));
     MOCK_METHOD1(mosquitto_disconnect, int(struct mosquitto *mosq));
     MOCK_METHOD7(mosquitto_publish,
           int(struct mosquitto *mosq, int *mid, const char *topic, int payloadlen,
                 const void *payload, int qos, bool retain));
+    MOCK_METHOD8(mosquitto_publish_v5,
+          int(struct mosquitto *mosq, int *mid, const char *topic, int payloadlen,
+                const void *payload, int qos, bool retain, const mosquitto_property *properties));
     MOCK_METHOD4(mosquitto_subscribe,
           int(struct mosquitto *mosq, int *mid, const char *sub, int qos));
+    MOCK_METHOD6(mosquitto_subscribe_v5,
+          int(struct mosquitto *mosq, int *mid, const char *sub, int qos, int options,
+                const mosquitto_property *properties));
     MOCK_METHOD3(mosquitto_unsubscribe, int(struct mosquitto *mosq, int *mid, const char *sub));
     MOCK_METHOD1(mosquitto_loop_start, int(struct mosquitto *mosq));
     MOCK_METHOD2(mosquitto_loop_stop, int(struct mosquitto *mosq, bool force));
@@ -55,4 +64,7 @@ class MQTTMock {
     MOCK_METHOD2(mosquitto_disconnect_v5_callback_set,
           void(struct mosquitto *mosq, void (*on_disconnect)(struct mosquitto *, void *, int,
                                              const mosquitto_property *)));
+    MOCK_METHOD2(mosquitto_publish_v5_callback_set,
+          void(struct mosquitto *mosq, void (*on_publish)(struct mosquitto *, void *, int, int,
+                                             const mosquitto_property *)));
 };
@@ -65,9 +65,17 @@ API int mosquitto_will_clear(struct mosquitto *mosq)
     return MQMockTest::GetMock().mosquitto_will_clear(mosq);
 }
 
-API int mosquitto_connect(struct mosquitto *mosq, const char *host, int port, int keepalive)
+API int mosquitto_connect_async(struct mosquitto *mosq, const char *host, int port,
+      int keepalive)
 {
-    return MQMockTest::GetMock().mosquitto_connect(mosq, host, port, keepalive);
+    return MQMockTest::GetMock().mosquitto_connect_async(mosq, host, port, keepalive);
+}
+
+API int mosquitto_reconnect_delay_set(struct mosquitto *mosq, unsigned int reconnect_delay,
+      unsigned int reconnect_delay_max, bool reconnect_exponential_backoff)
+{
+    return MQMockTest::GetMock().mosquitto_reconnect_delay_set(mosq, reconnect_delay,
+          reconnect_delay_max, reconnect_exponential_backoff);
 }
 
 API int mosquitto_disconnect(struct mosquitto *mosq)
@@ -82,11 +90,24 @@ API int mosquitto_publish(struct mosquitto *mosq, int *mid, const char *topic, i
           retain);
 }
 
+API int mosquitto_publish_v5(struct mosquitto *mosq, int *mid, const char *topic, int payloadlen,
+      const void *payload, int qos, bool retain, const mosquitto_property *properties)
+{
+    return MQMockTest::GetMock().mosquitto_publish_v5(mosq, mid, topic, payloadlen, payload, qos,
+          retain, properties);
+}
+
 API int mosquitto_subscribe(struct mosquitto *mosq, int *mid, const char *sub, int qos)
 {
     return MQMockTest::GetMock().mosquitto_subscribe(mosq, mid, sub, qos);
 }
 
+API int mosquitto_subscribe_v5(struct mosquitto *mosq, int *mid, const char *sub, int qos,
+      int options, const mosquitto_property *properties)
+{
+    return MQMockTest::GetMock().mosquitto_subscribe_v5(mosq, mid, sub, qos, options, properties);
+}
+
 API int mosquitto_unsubscribe(struct mosquitto *mosq, int *mid, const char *sub)
 {
     return MQMockTest::GetMock().mosquitto_unsubscribe(mosq, mid, sub);
@@ -121,4 +142,10 @@ API void mosquitto_disconnect_v5_callback_set(struct mosquitto *mosq,
     return MQMockTest::GetMock().mosquitto_disconnect_v5_callback_set(mosq, on_disconnect);
 }
 
+API void mosquitto_publish_v5_callback_set(struct mosquitto *mosq,
+      void (*on_publish)(struct mosquitto *, void *, int, int, const mosquitto_property *))
+{
+    return MQMockTest::GetMock().mosquitto_publish_v5_callback_set(mosq, on_publish);
+}
+
 }  // extern "C"
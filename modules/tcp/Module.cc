@@ -17,6 +17,8 @@
 
 #include <AittUtil.h>
 #include <flatbuffers/flexbuffers.h>
+#include <string.h>
+#include <sys/uio.h>
 #include <unistd.h>
 
 #include <random>
@@ -25,10 +27,14 @@
 
 namespace AittTCPNamespace {
 
-Module::Module(AittProtocol type, AittDiscovery &discovery, const std::string &my_ip)
+Module::Module(AittProtocol type, AittDiscovery &discovery, const std::string &my_ip,
+      const AittOption &option)
       : AittTransport(type, discovery), ip(my_ip), secure(type == AITT_TYPE_TCP_SECURE)
 {
-    aittThread = std::thread(&Module::ThreadMain, this);
+    for (int i = 0; i < option.GetTCPReactorThreads(); i++)
+        reactors.push_back(std::unique_ptr<Reactor>(new Reactor()));
+    for (size_t i = 0; i < reactors.size(); i++)
+        reactors[i]->thread = std::thread(&Module::ThreadMain, this, i);
 
     discovery_cb = discovery.AddDiscoveryCB(type,
           std::bind(&Module::DiscoveryMessageCallback, this, std::placeholders::_1,
@@ -44,26 +50,48 @@ Module::~Module(void)
         ERR("RemoveDiscoveryCB() Fail(%s)", e.what());
     }
 
-    while (main_loop.Quit() == false) {
-        // wait when called before the thread has completely created.
-        usleep(1000);
-    }
+    for (auto &reactor : reactors) {
+        while (reactor->main_loop.Quit() == false) {
+            // wait when called before the thread has completely created.
+            usleep(1000);
+        }
 
-    if (aittThread.joinable())
-        aittThread.join();
+        if (reactor->thread.joinable())
+            reactor->thread.join();
+    }
 }
 
-void Module::ThreadMain(void)
+void Module::ThreadMain(size_t index)
 {
-    if (secure)
-        pthread_setname_np(pthread_self(), "SecureTCPLoop");
-    else
-        pthread_setname_np(pthread_self(), "NormalTCPLoop");
-    main_loop.Run();
+    std::string name = secure ? "SecureTCPLoop" : "NormalTCPLoop";
+    if (index)
+        name += std::to_string(index);
+    pthread_setname_np(pthread_self(), name.substr(0, 15).c_str());
+    reactors[index]->main_loop.Run();
 }
 
 void Module::Publish(const std::string &topic, const void *data, const size_t datalen,
       const std::string &correlation, AittQoS qos, bool retain)
+{
+    AittPublishEntry message = {topic.c_str(), data, datalen, qos};
+    SendMessages(&message, 1);
+}
+
+void Module::Publish(const std::string &topic, const void *data, const size_t datalen, AittQoS qos,
+      bool retain)
+{
+    Publish(topic, data, datalen, std::string(), qos, retain);
+}
+
+void Module::PublishBatch(const std::vector<AittPublishEntry> &entries)
+{
+    if (entries.empty())
+        return;
+
+    SendMessages(entries.data(), entries.size());
+}
+
+void Module::SendMessages(const AittPublishEntry *messages, size_t count)
 {
     // NOTE:
     // Iterate discovered service table
@@ -77,13 +105,25 @@ void Module::Publish(const std::string &topic, const void *data, const size_t da
     //       },
     //    },
     // }
+    std::vector<struct iovec> frames;
     std::lock_guard<std::mutex> auto_lock_publish(publishTableLock);
     for (PublishMap::iterator it = publishTable.begin(); it != publishTable.end(); ++it) {
-        // NOTE: Find entries that have matched with the given topic
-        if (!aitt::AittUtil::CompareTopic(it->first, topic))
+        // NOTE: Find messages that have matched with the entry.
+        // Each of them is sent as a topic frame followed by a data frame.
+        frames.clear();
+        for (size_t i = 0; i < count; i++) {
+            size_t topic_length = strlen(messages[i].topic);
+            if (!it->second.filter.Match(messages[i].topic, topic_length))
+                continue;
+
+            frames.push_back({const_cast<char *>(messages[i].topic), topic_length});
+            frames.push_back({const_cast<void *>(messages[i].data), messages[i].datalen});
+        }
+        if (frames.empty())
             continue;
 
-        for (HostMap::iterator hostIt = it->second.begin(); hostIt != it->second.end(); ++hostIt) {
+        HostMap &hosts = it->second.hosts;
+        for (HostMap::iterator hostIt = hosts.begin(); hostIt != hosts.end(); ++hostIt) {
             // Iterate all ports,
             // the current implementation only be able to have the ZERO or a SINGLE entry
             for (PortMap::iterator portIt = hostIt->second.begin(); portIt != hostIt->second.end();
@@ -121,10 +161,7 @@ void Module::Publish(const std::string &topic, const void *data, const size_t da
                 }
 
                 try {
-                    size_t length = topic.length();
-                    portIt->second->SendSizedData(topic.c_str(), length);
-                    length = datalen;
-                    portIt->second->SendSizedData(data, length);
+                    portIt->second->SendSizedData(frames.data(), frames.size());
                 } catch (std::exception &e) {
                     ERR("An exception(%s) occurs during Send().", e.what());
                 }
@@ -133,12 +170,6 @@ void Module::Publish(const std::string &topic, const void *data, const size_t da
     }      // publishTable
 }
 
-void Module::Publish(const std::string &topic, const void *data, const size_t datalen, AittQoS qos,
-      bool retain)
-{
-    Publish(topic, data, datalen, std::string(), qos, retain);
-}
-
 void *Module::Subscribe(const std::string &topic, const AittTransport::SubscribeCallback &cb,
       void *cbdata, AittQoS qos)
 {
@@ -153,7 +184,7 @@ void *Module::Subscribe(const std::string &topic, const AittTransport::Subscribe
     listen_info->topic = topic;
     auto handle = tcpServer->GetHandle();
 
-    main_loop.AddWatch(handle, AcceptConnection, listen_info);
+    reactors[0]->main_loop.AddWatch(handle, AcceptConnection, listen_info);
 
     {
         std::lock_guard<std::mutex> autoLock(subscribeTableLock);
@@ -173,7 +204,8 @@ void *Module::Subscribe(const std::string &topic, const AittTransport::Subscribe
 void *Module::Unsubscribe(void *handlePtr)
 {
     int handle = static_cast<int>(reinterpret_cast<intptr_t>(handlePtr));
-    TCPServerData *listen_info = dynamic_cast<TCPServerData *>(main_loop.RemoveWatch(handle));
+    TCPServerData *listen_info =
+          dynamic_cast<TCPServerData *>(reactors[0]->main_loop.RemoveWatch(handle));
     if (!listen_info)
         return nullptr;
 
@@ -190,8 +222,9 @@ void *Module::Unsubscribe(void *handlePtr)
 
     void *cbdata = listen_info->cbdata;
     listen_info->client_lock.lock();
-    for (auto fd : listen_info->client_list) {
-        TCPData *tcp_data = dynamic_cast<TCPData *>(main_loop.RemoveWatch(fd));
+    for (TCPData *tcp_data : listen_info->client_list) {
+        if (tcp_data->reactor->main_loop.RemoveWatch(tcp_data->client->GetHandle()))
+            tcp_data->reactor->connections--;
         delete tcp_data;
     }
     listen_info->client_list.clear();
@@ -218,7 +251,7 @@ void Module::DiscoveryMessageCallback(const std::string &clientId, const std::st
             // NOTE: Iterate all topics in the publishTable holds discovered client information
             std::lock_guard<std::mutex> autoLock(publishTableLock);
             for (auto it = publishTable.begin(); it != publishTable.end(); ++it)
-                it->second.erase(clientId);
+                it->second.hosts.erase(clientId);
         }
         return;
     }
@@ -323,7 +356,7 @@ void Module::ReceiveData(MainLoopHandler::MainLoopResult result, int handle,
 
     if (result == MainLoopHandler::HANGUP) {
         ERR("The main loop hung up. Disconnect the client.");
-        return impl->HandleClientDisconnect(handle);
+        return impl->HandleClientDisconnect(tcp_data);
     }
 
     size_t szmsg = 0;
@@ -340,7 +373,7 @@ void Module::ReceiveData(MainLoopHandler::MainLoopResult result, int handle,
         int ret = tcp_data->client->RecvSizedData((void **)&msg, szmsg);
         if (ret < 0) {
             ERR("Got a disconnection message.");
-            return impl->HandleClientDisconnect(handle);
+            return impl->HandleClientDisconnect(tcp_data);
         }
     } catch (std::exception &e) {
         ERR("An exception(%s) occurs", e.what());
@@ -355,22 +388,37 @@ void Module::ReceiveData(MainLoopHandler::MainLoopResult result, int handle,
     free(msg);
 }
 
-void Module::HandleClientDisconnect(int handle)
+void Module::HandleClientDisconnect(TCPData *tcp_data)
 {
-    TCPData *tcp_data = dynamic_cast<TCPData *>(main_loop.RemoveWatch(handle));
-    if (tcp_data == nullptr) {
-        ERR("No watch data");
+    // Unsubscribe() removes and deletes the clients of the server under the same lock
+    TCPServerData *parent = tcp_data->parent;
+    std::lock_guard<std::mutex> autoLock(parent->client_lock);
+    auto it = std::find(parent->client_list.begin(), parent->client_list.end(), tcp_data);
+    if (it == parent->client_list.end()) {
+        ERR("Unknown client");
         return;
     }
-    tcp_data->parent->client_lock.lock();
-    auto it = std::find(tcp_data->parent->client_list.begin(), tcp_data->parent->client_list.end(),
-          handle);
-    tcp_data->parent->client_list.erase(it);
-    tcp_data->parent->client_lock.unlock();
+    parent->client_list.erase(it);
+
+    Reactor *reactor = tcp_data->reactor;
+    if (reactor->main_loop.RemoveWatch(tcp_data->client->GetHandle()) == nullptr)
+        ERR("No watch data");
+    else
+        reactor->connections--;
 
     delete tcp_data;
 }
 
+Module::Reactor *Module::NextReactor(void)
+{
+    Reactor *next = reactors[0].get();
+    for (auto &reactor : reactors) {
+        if (reactor->connections < next->connections)
+            next = reactor.get();
+    }
+    return next;
+}
+
 std::string Module::GetTopicName(Module::TCPData *tcp_data)
 {
     size_t topic_length = 0;
@@ -378,7 +426,7 @@ std::string Module::GetTopicName(Module::TCPData *tcp_data)
     int ret = tcp_data->client->RecvSizedData(&topic_data, topic_length);
     if (ret < 0) {
         ERR("Got a disconnection message.");
-        HandleClientDisconnect(tcp_data->client->GetHandle());
+        HandleClientDisconnect(tcp_data);
         return std::string();
     }
     if (nullptr == topic_data) {
@@ -418,13 +466,20 @@ void Module::AcceptConnection(MainLoopHandler::MainLoopResult result, int handle
     }
 
     int client_handle = client->GetHandle();
-    listen_info->client_list.push_back(client_handle);
+    Reactor *reactor = impl->NextReactor();
 
     TCPData *ecd = new TCPData;
     ecd->parent = listen_info;
+    ecd->reactor = reactor;
     ecd->client = std::move(client);
 
-    impl->main_loop.AddWatch(client_handle, ReceiveData, ecd);
+    {
+        // Other reactors remove their clients from the list on disconnection
+        std::lock_guard<std::mutex> autoLock(listen_info->client_lock);
+        listen_info->client_list.push_back(ecd);
+    }
+    reactor->connections++;
+    reactor->main_loop.AddWatch(client_handle, ReceiveData, ecd);
 }
 
 void Module::UpdatePublishTable(const std::string &topic, const std::string &clientId,
@@ -434,17 +489,18 @@ void Module::UpdatePublishTable(const std::string &topic, const std::string &cli
     if (topicIt == publishTable.end()) {
         PortMap portMap;
         portMap.insert(PortMap::value_type(info, nullptr));
-        HostMap hostMap;
-        hostMap.insert(HostMap::value_type(clientId, std::move(portMap)));
-        publishTable.insert(PublishMap::value_type(topic, std::move(hostMap)));
+        PublishEntry entry(topic);
+        entry.hosts.insert(HostMap::value_type(clientId, std::move(portMap)));
+        publishTable.insert(PublishMap::value_type(topic, std::move(entry)));
         return;
     }
 
-    auto hostIt = topicIt->second.find(clientId);
-    if (hostIt == topicIt->second.end()) {
+    HostMap &hosts = topicIt->second.hosts;
+    auto hostIt = hosts.find(clientId);
+    if (hostIt == hosts.end()) {
         PortMap portMap;
         portMap.insert(PortMap::value_type(info, nullptr));
-        topicIt->second.insert(HostMap::value_type(clientId, std::move(portMap)));
+        hosts.insert(HostMap::value_type(clientId, std::move(portMap)));
         return;
     }
 
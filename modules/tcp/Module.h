@@ -16,8 +16,10 @@
 #pragma once
 
 #include <AittTransport.h>
+#include <AittUtil.h>
 #include <MainLoopHandler.h>
 
+#include <atomic>
 #include <map>
 #include <memory>
 #include <mutex>
@@ -36,7 +38,8 @@ namespace AittTCPNamespace {
 
 class Module : public AittTransport {
   public:
-    explicit Module(AittProtocol type, AittDiscovery &discovery, const std::string &ip);
+    explicit Module(AittProtocol type, AittDiscovery &discovery, const std::string &ip,
+          const AittOption &option);
     virtual ~Module(void);
 
     void Publish(const std::string &topic, const void *data, const size_t datalen,
@@ -46,6 +49,9 @@ class Module : public AittTransport {
     void Publish(const std::string &topic, const void *data, const size_t datalen,
           AittQoS qos = AITT_QOS_AT_MOST_ONCE, bool retain = false) override;
 
+    // The messages to each subscriber are coalesced into a single writev()
+    void PublishBatch(const std::vector<AittPublishEntry> &entries) override;
+
     void *Subscribe(const std::string &topic, const SubscribeCallback &cb, void *cbdata = nullptr,
           AittQoS qos = AITT_QOS_AT_MOST_ONCE) override;
 
@@ -55,17 +61,31 @@ class Module : public AittTransport {
     void *Unsubscribe(void *handle) override;
 
   private:
+    // Event loop thread, see AittOption::SetTCPReactorThreads().
+    // Listening sockets are watched by the first one, and each accepted connection by the one
+    // with the fewest connections, so that the data of a connection is received in order.
+    struct Reactor {
+        Reactor(void) : connections(0) {}
+
+        MainLoopHandler main_loop;
+        std::thread thread;
+        std::atomic<int> connections;
+    };
+
+    struct TCPData;
+
     struct TCPServerData : public MainLoopHandler::MainLoopData {
         Module *impl;
         SubscribeCallback cb;
         void *cbdata;
         std::string topic;
-        std::vector<int> client_list;
+        std::vector<TCPData *> client_list;
         std::mutex client_lock;
     };
 
     struct TCPData : public MainLoopHandler::MainLoopData {
         TCPServerData *parent;
+        Reactor *reactor;
         std::unique_ptr<TCP> client;
     };
 
@@ -107,7 +127,14 @@ class Module : public AittTransport {
     using PortMap =
           std::map<TCP::ConnectInfo /* port */, std::unique_ptr<TCP>, TCP::ConnectInfo::Compare>;
     using HostMap = std::map<std::string /* clientId */, PortMap>;
-    using PublishMap = std::map<std::string /* topic */, HostMap>;
+    // The filter is compiled once, since every publish matches against all of the entries
+    struct PublishEntry {
+        explicit PublishEntry(const std::string &topic) : filter(topic) {}
+
+        aitt::AittUtil::TopicFilter filter;
+        HostMap hosts;
+    };
+    using PublishMap = std::map<std::string /* topic */, PublishEntry>;
 
     static void AcceptConnection(MainLoopHandler::MainLoopResult result, int handle,
           MainLoopHandler::MainLoopData *watchData);
@@ -116,14 +143,15 @@ class Module : public AittTransport {
     void UpdateDiscoveryMsg();
     static void ReceiveData(MainLoopHandler::MainLoopResult result, int handle,
           MainLoopHandler::MainLoopData *watchData);
-    void HandleClientDisconnect(int handle);
+    void HandleClientDisconnect(TCPData *tcp_data);
+    Reactor *NextReactor(void);
+    void SendMessages(const AittPublishEntry *messages, size_t count);
     std::string GetTopicName(TCPData *connect_info);
-    void ThreadMain(void);
+    void ThreadMain(size_t index);
     void UpdatePublishTable(const std::string &topic, const std::string &host,
           const TCP::ConnectInfo &info);
 
-    MainLoopHandler main_loop;
-    std::thread aittThread;
+    std::vector<std::unique_ptr<Reactor>> reactors;
     int discovery_cb;
 
     PublishMap publishTable;
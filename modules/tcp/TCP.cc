@@ -21,11 +21,15 @@
 #include <netinet/tcp.h>
 #include <sys/socket.h>
 #include <sys/types.h>
+#include <sys/uio.h>
 #include <unistd.h>
 
+#include <algorithm>
+#include <climits>
 #include <cstdlib>
 #include <cstring>
 #include <stdexcept>
+#include <vector>
 
 #include "aitt_internal.h"
 
@@ -137,6 +141,72 @@ void TCP::SendSizedData(const void *data, size_t &szData)
         SendSizedDataNormal(data, szData);
 }
 
+void TCP::SendSizedData(const struct iovec *buffers, size_t count)
+{
+    std::vector<struct iovec> iov;
+    iov.reserve(count * 2);
+    // Sizes and cryptograms are referred by iov until they are sent
+    std::vector<size_t> sizes(count);
+    std::vector<std::vector<unsigned char>> cryptograms;
+    if (secure)
+        cryptograms.reserve(count * 2);
+
+    for (size_t i = 0; i < count; i++) {
+        size_t data_size = buffers[i].iov_len;
+        // distinguish between connection problems and zero-size messages
+        sizes[i] = data_size ? data_size : UINT32_MAX;
+
+        if (secure == false) {
+            iov.push_back({&sizes[i], sizeof(sizes[i])});
+            if (data_size)
+                iov.push_back(buffers[i]);
+            continue;
+        }
+
+        std::vector<unsigned char> data_buf;
+        if (data_size) {
+            data_buf.resize(crypto.GetCryptogramSize(data_size));
+            sizes[i] = crypto.Encrypt(static_cast<const unsigned char *>(buffers[i].iov_base),
+                  data_size, data_buf.data());
+        }
+        std::vector<unsigned char> size_buf(crypto.GetCryptogramSize(sizeof(size_t)));
+        size_t size_len = crypto.Encrypt(reinterpret_cast<unsigned char *>(&sizes[i]),
+              sizeof(sizes[i]), size_buf.data());
+
+        cryptograms.push_back(std::move(size_buf));
+        iov.push_back({cryptograms.back().data(), size_len});
+        if (data_size) {
+            cryptograms.push_back(std::move(data_buf));
+            iov.push_back({cryptograms.back().data(), sizes[i]});
+        }
+    }
+
+    SendVector(iov.data(), iov.size());
+}
+
+void TCP::SendVector(struct iovec *iov, size_t iovcnt)
+{
+    while (iovcnt) {
+        ssize_t ret = writev(handle, iov, std::min<size_t>(iovcnt, IOV_MAX));
+        if (ret < 0) {
+            ERR("Fail to send data, handle = %d, count = %zu", handle, iovcnt);
+            throw std::runtime_error(strerror(errno));
+        }
+
+        // Skip the buffers written, and the part written of the next one
+        size_t written = ret;
+        while (iovcnt && iov->iov_len <= written) {
+            written -= iov->iov_len;
+            iov++;
+            iovcnt--;
+        }
+        if (written) {
+            iov->iov_base = static_cast<char *>(iov->iov_base) + written;
+            iov->iov_len -= written;
+        }
+    }
+}
+
 int TCP::Recv(void *data, size_t &szData)
 {
     size_t received = 0;
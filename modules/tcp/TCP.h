@@ -17,6 +17,7 @@
 
 #include <sys/socket.h>
 #include <sys/types.h> /* See NOTES */
+#include <sys/uio.h>
 
 #include <string>
 
@@ -47,6 +48,8 @@ class TCP {
 
     void Send(const void *data, size_t &szData);
     void SendSizedData(const void *data, size_t &szData);
+    // Sends each buffer as SendSizedData() does, with as few system calls as possible
+    void SendSizedData(const struct iovec *buffers, size_t count);
     int Recv(void *data, size_t &szData);
     int RecvSizedData(void **data, size_t &szData);
     int GetHandle(void);
@@ -56,6 +59,7 @@ class TCP {
   private:
     TCP(int handle, sockaddr *addr, socklen_t addrlen, const ConnectInfo &connect_info);
     void SetupOptions(const ConnectInfo &connect_info);
+    void SendVector(struct iovec *iov, size_t iovcnt);
     int HandleZeroMsg(void **data, size_t &data_size);
     void SendSizedDataNormal(const void *data, size_t &data_size);
     int RecvSizedDataNormal(void **data, size_t &data_size);
@@ -16,11 +16,14 @@
 #include <gtest/gtest.h>
 
 #include <condition_variable>
+#include <cstdlib>
 #include <cstring>
 #include <functional>
 #include <memory>
 #include <mutex>
+#include <string>
 #include <thread>
+#include <vector>
 
 #include "../TCPServer.h"
 
@@ -65,7 +68,11 @@ class TCPTest : public testing::Test {
         peer = tcp->AcceptPeer();
     }
 
-    void TearDown() override { clientThread.join(); }
+    void TearDown() override
+    {
+        if (clientThread.joinable())
+            clientThread.join();
+    }
 
   protected:
     std::mutex m;
@@ -153,3 +160,34 @@ TEST_F(TCPTest, SendRecv_P_Anytime)
     ASSERT_STREQ(helloBuffer, TEST_BUFFER_HELLO);
     ASSERT_STREQ(byeBuffer, TEST_BUFFER_BYE);
 }
+
+TEST_F(TCPTest, SendSizedData_Batch_P_Anytime)
+{
+    std::vector<std::string> received;
+
+    customTest = [this, &received](void) mutable -> void {
+        for (int i = 0; i < 3; i++) {
+            void *data = nullptr;
+            size_t szData = 0;
+            if (client->RecvSizedData(&data, szData) < 0)
+                break;
+            received.push_back(data ? std::string(static_cast<char *>(data), szData) : "");
+            free(data);
+        }
+    };
+
+    RunServer();
+
+    struct iovec buffers[] = {
+          {const_cast<char *>(TEST_BUFFER_HELLO), strlen(TEST_BUFFER_HELLO)},
+          {nullptr, 0},
+          {const_cast<char *>(TEST_BUFFER_BYE), strlen(TEST_BUFFER_BYE)},
+    };
+    peer->SendSizedData(buffers, 3);
+
+    clientThread.join();
+    ASSERT_EQ(received.size(), 3);
+    EXPECT_EQ(received[0], TEST_BUFFER_HELLO);
+    EXPECT_TRUE(received[1].empty());
+    EXPECT_EQ(received[2], TEST_BUFFER_BYE);
+}
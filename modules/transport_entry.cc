@@ -23,12 +23,13 @@
 using namespace MODULE_NAMESPACE;
 
 extern "C" {
-API void *AITT_TRANSPORT_NEW(AittProtocol type, AittDiscovery &discovery, const std::string &my_ip)
+API void *AITT_TRANSPORT_NEW(AittProtocol type, AittDiscovery &discovery, const std::string &my_ip,
+      const AittOption &option)
 {
     assert(STR_EQ == strcmp(__func__, aitt::AittTransport::MODULE_ENTRY_NAME)
            && "Entry point name is not matched");
 
-    Module *module = new Module(type, discovery, my_ip);
+    Module *module = new Module(type, discovery, my_ip, option);
 
     // validate that the module creates valid object (which inherits AittTransport)
     AittTransport *transport_module = dynamic_cast<AittTransport *>(module);
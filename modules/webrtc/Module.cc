@@ -23,7 +23,8 @@
 
 namespace AittWebRTCNamespace {
 
-Module::Module(AittProtocol type, AittDiscovery &discovery, const std::string &ip)
+Module::Module(AittProtocol type, AittDiscovery &discovery, const std::string &ip,
+      const AittOption &option)
       : AittTransport(type, discovery)
 {
 }
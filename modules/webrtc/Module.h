@@ -38,7 +38,8 @@ namespace AittWebRTCNamespace {
 
 class Module : public AittTransport {
   public:
-    explicit Module(AittProtocol type, AittDiscovery &discovery, const std::string &ip);
+    explicit Module(AittProtocol type, AittDiscovery &discovery, const std::string &ip,
+          const AittOption &option);
     virtual ~Module(void);
 
     // TODO: How about regarding topic as service name?
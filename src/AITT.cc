@@ -60,6 +60,11 @@ void AITT::SetConnectionCallback(ConnectionCallback cb, void *user_data)
     return pImpl->SetConnectionCallback(cb, user_data);
 }
 
+void AITT::SetPublishAckCallback(PublishAckCallback cb, void *user_data)
+{
+    return pImpl->SetPublishAckCallback(cb, user_data);
+}
+
 void AITT::Connect(const std::string &host, int port, const std::string &username,
       const std::string &password)
 {
@@ -82,6 +87,22 @@ void AITT::Publish(const std::string &topic, const void *data, const size_t data
     return pImpl->Publish(topic, data, datalen, protocols, qos, retain);
 }
 
+void AITT::PublishBatch(const std::vector<AittPublishEntry> &entries, AittProtocol protocols)
+{
+    for (const AittPublishEntry &entry : entries) {
+        if (entry.topic == nullptr) {
+            ERR("Invalid Topic");
+            throw std::runtime_error("Invalid Topic");
+        }
+        if (AITT_PAYLOAD_MAX < entry.datalen) {
+            ERR("Invalid Size(%zu)", entry.datalen);
+            throw std::runtime_error("Invalid Size");
+        }
+    }
+
+    return pImpl->PublishBatch(entries, protocols);
+}
+
 int AITT::PublishWithReply(const std::string &topic, const void *data, const size_t datalen,
       AittProtocol protocol, AittQoS qos, bool retain, const SubscribeCallback &cb, void *cbdata,
       const std::string &correlation)
@@ -108,10 +129,23 @@ int AITT::PublishWithReplySync(const std::string &topic, const void *data, const
           correlation, timeout_ms);
 }
 
+std::future<std::vector<AITT::Reply>> AITT::PublishWithReplyAsync(const std::string &topic,
+      const void *data, const size_t datalen, AittProtocol protocol, AittQoS qos,
+      const std::string &correlation, int timeout_ms)
+{
+    if (AITT_PAYLOAD_MAX < datalen) {
+        ERR("Invalid Size(%zu)", datalen);
+        throw std::runtime_error("Invalid Size");
+    }
+
+    return pImpl->PublishWithReplyAsync(topic, data, datalen, protocol, qos, correlation,
+          timeout_ms);
+}
+
 AittSubscribeID AITT::Subscribe(const std::string &topic, const SubscribeCallback &cb, void *cbdata,
-      AittProtocol protocols, AittQoS qos)
+      AittProtocol protocols, AittQoS qos, int flags)
 {
-    return pImpl->Subscribe(topic, cb, cbdata, protocols, qos);
+    return pImpl->Subscribe(topic, cb, cbdata, protocols, qos, flags);
 }
 
 void *AITT::Unsubscribe(AittSubscribeID handle)
@@ -18,16 +18,20 @@
 #include <flatbuffers/flexbuffers.h>
 
 #include <cerrno>
+#include <chrono>
 #include <cstring>
 #include <functional>
 #include <memory>
 #include <stdexcept>
 
 #include "MosquittoMQ.h"
+#include "ShardedMQ.h"
 #include "aitt_internal.h"
 
 #define WEBRTC_ROOM_ID_PREFIX std::string(AITT_MANAGED_TOPIC_PREFIX "webrtc/room/Room.webrtc")
 #define WEBRTC_ID_POSTFIX std::string("_for_webrtc")
+#define DELIVERY_BATCH_MAX 256
+#define DELIVERY_HIGH_WEIGHT 8
 
 namespace aitt {
 
@@ -35,21 +39,44 @@ AITT::Impl::Impl(AITT &parent, const std::string &id, const std::string &my_ip,
       const AittOption &option)
       : public_api(parent),
         discovery(id),
-        modules(my_ip, discovery),
+        modules(my_ip, discovery, option),
+        next_worker(0),
         id_(id),
         mqtt_broker_port_(0),
-        reply_id(0)
+        reply_id(0),
+        multiplex_reply(option.GetMultiplexReply()),
+        reply_topic_prefix(REPLY_TOPIC_BASE + id + "/"),
+        reply_topic_handle(nullptr),
+        shared_discovery(option.GetSharedDiscovery())
 {
     if (option.GetUseCustomMqttBroker()) {
         mq = modules.NewCustomMQ(id, option);
+    } else if (option.GetMQConnections() > 1) {
+        std::vector<std::unique_ptr<MQ>> connections;
+        for (int i = 0; i < option.GetMQConnections(); i++)
+            connections.push_back(NewMosquittoMQ(id + '.' + std::to_string(i), option));
+        mq = std::unique_ptr<MQ>(new ShardedMQ(std::move(connections)));
+    } else {
+        mq = NewMosquittoMQ(id, option);
+    }
+
+    if (shared_discovery) {
+        discovery.SetSharedMQ(mq.get());
+        // ConnectionCB() passes the connection state to the discovery
+        mq->SetConnectionCallback(
+              std::bind(&Impl::ConnectionCB, this, nullptr, nullptr, std::placeholders::_1));
+    } else if (option.GetUseCustomMqttBroker()) {
         AittOption discovery_option = option;
         discovery_option.SetClearSession(false);
         discovery.SetMQ(modules.NewCustomMQ(id + 'd', option));
     } else {
-        mq = std::unique_ptr<MQ>(new MosquittoMQ(id, option.GetClearSession()));
         discovery.SetMQ(std::unique_ptr<MQ>(new MosquittoMQ(id + 'd', false)));
     }
+    WatchDeliveries(main_loop, delivery_queues);
     aittThread = std::thread(&AITT::Impl::ThreadMain, this);
+
+    for (int i = 1; i < option.GetCallbackThreads(); i++)
+        workers.push_back(std::unique_ptr<Worker>(new Worker(i)));
 }
 
 AITT::Impl::~Impl(void)
@@ -68,6 +95,8 @@ AITT::Impl::~Impl(void)
 
     if (aittThread.joinable())
         aittThread.join();
+
+    workers.clear();
 }
 
 void AITT::Impl::ThreadMain(void)
@@ -76,31 +105,84 @@ void AITT::Impl::ThreadMain(void)
     main_loop.Run();
 }
 
+AITT::Impl::Worker::Worker(int index)
+{
+    WatchDeliveries(loop, queues);
+    thread = std::thread(&Worker::ThreadMain, this, index);
+}
+
+AITT::Impl::Worker::~Worker(void)
+{
+    while (loop.Quit() == false) {
+        // wait when called before the thread has completely created.
+        usleep(1000);  // 1millisecond
+    }
+
+    if (thread.joinable())
+        thread.join();
+}
+
+void AITT::Impl::Worker::ThreadMain(int index)
+{
+    char name[16];
+    snprintf(name, sizeof(name), "AITTWorker%d", index);
+    pthread_setname_np(pthread_self(), name);
+    loop.Run();
+}
+
 void AITT::Impl::SetWillInfo(const std::string &topic, const void *data, const size_t datalen,
       AittQoS qos, bool retain)
 {
+    if (shared_discovery) {
+        ERR("The will is used by the discovery");
+        throw AittException(AittException::OPERATION_FAILED);
+    }
+
     mq->SetWillInfo(topic, data, datalen, qos, retain);
 }
 
 void AITT::Impl::SetConnectionCallback(ConnectionCallback cb, void *user_data)
 {
-    if (cb)
+    if (cb || shared_discovery)
         mq->SetConnectionCallback(
               std::bind(&Impl::ConnectionCB, this, cb, user_data, std::placeholders::_1));
     else
         mq->SetConnectionCallback(nullptr);
 }
 
+void AITT::Impl::SetPublishAckCallback(AITT::PublishAckCallback cb, void *user_data)
+{
+    if (cb)
+        mq->SetPublishAckCallback(
+              [this, cb, user_data](const std::string &topic, int result) {
+                  cb(public_api, topic, result, user_data);
+              });
+    else
+        mq->SetPublishAckCallback(nullptr);
+}
+
+std::unique_ptr<MQ> AITT::Impl::NewMosquittoMQ(const std::string &id, const AittOption &option)
+{
+    MosquittoMQ *mosquitto_mq = new MosquittoMQ(id, option.GetClearSession());
+    std::unique_ptr<MQ> connection(mosquitto_mq);
+    mosquitto_mq->SetLegacyReplyFormat(option.GetLegacyReplyFormat());
+    mosquitto_mq->SetPublishLimits(option.GetMaxInflight(), option.GetMaxQueued());
+    return connection;
+}
+
 void AITT::Impl::ConnectionCB(ConnectionCallback cb, void *user_data, int status)
 {
-    RET_IF(cb == nullptr);
+    if (shared_discovery)
+        discovery.ConnectionCallback(status);
 
-    cb(public_api, status, user_data);
+    if (cb)
+        cb(public_api, status, user_data);
 }
 
 void AITT::Impl::Connect(const std::string &host, int port, const std::string &username,
       const std::string &password)
 {
+    // Neither waits for CONNACK, so both connections are made at the same time
     discovery.Start(host, port, username, password);
     mq->Connect(host, port, username, password);
 
@@ -111,6 +193,7 @@ void AITT::Impl::Connect(const std::string &host, int port, const std::string &u
 void AITT::Impl::Disconnect(void)
 {
     UnsubscribeAll();
+    UnsubscribeReplyTopic();
 
     mqtt_broker_ip_.clear();
     mqtt_broker_port_ = -1;
@@ -123,25 +206,27 @@ void AITT::Impl::UnsubscribeAll()
 {
     std::unique_lock<std::mutex> lock(subscribed_list_mutex_);
 
-    for (auto subscribe_info : subscribed_list) {
-        switch (subscribe_info->first) {
+    subscribed_list.ForEach([this](SubscribeInfo &subscribe_info) {
+        // Still in Subscribe(), which unsubscribes it when it finds the entry removed
+        if (subscribe_info.second == nullptr)
+            return;
+
+        switch (subscribe_info.first) {
         case AITT_TYPE_MQTT:
-            mq->Unsubscribe(subscribe_info->second);
+            mq->Unsubscribe(subscribe_info.second);
             break;
         case AITT_TYPE_TCP:
         case AITT_TYPE_TCP_SECURE:
         case AITT_TYPE_WEBRTC:
-            modules.Get(subscribe_info->first).Unsubscribe(subscribe_info->second);
+            modules.Get(subscribe_info.first).Unsubscribe(subscribe_info.second);
             break;
 
         default:
-            ERR("Unknown AittProtocol(%d)", subscribe_info->first);
+            ERR("Unknown AittProtocol(%d)", subscribe_info.first);
             break;
         }
-
-        delete subscribe_info;
-    }
-    subscribed_list.clear();
+    });
+    subscribed_list.Clear();
 }
 
 void AITT::Impl::ConfigureTransportModule(const std::string &key, const std::string &value,
@@ -165,6 +250,24 @@ void AITT::Impl::Publish(const std::string &topic, const void *data, const size_
         PublishWebRtc(topic, data, datalen, qos, retain);
 }
 
+void AITT::Impl::PublishBatch(const std::vector<AittPublishEntry> &entries,
+      AittProtocol protocols)
+{
+    if ((protocols & AITT_TYPE_MQTT) == AITT_TYPE_MQTT)
+        mq->PublishBatch(entries);
+
+    if ((protocols & AITT_TYPE_TCP) == AITT_TYPE_TCP)
+        modules.Get(AITT_TYPE_TCP).PublishBatch(entries);
+
+    if ((protocols & AITT_TYPE_TCP_SECURE) == AITT_TYPE_TCP_SECURE)
+        modules.Get(AITT_TYPE_TCP_SECURE).PublishBatch(entries);
+
+    if ((protocols & AITT_TYPE_WEBRTC) == AITT_TYPE_WEBRTC) {
+        for (const AittPublishEntry &entry : entries)
+            PublishWebRtc(entry.topic, entry.data, entry.datalen, entry.qos, false);
+    }
+}
+
 void AITT::Impl::PublishWebRtc(const std::string &topic, const void *data, const size_t datalen,
       AittQoS qos, bool retain)
 {
@@ -184,102 +287,176 @@ void AITT::Impl::PublishWebRtc(const std::string &topic, const void *data, const
 }
 
 AittSubscribeID AITT::Impl::Subscribe(const std::string &topic, const AITT::SubscribeCallback &cb,
-      void *user_data, AittProtocol protocol, AittQoS qos)
+      void *user_data, AittProtocol protocol, AittQoS qos, int flags)
 {
-    SubscribeInfo *info = new SubscribeInfo();
-    info->first = protocol;
-
-    void *subscribe_handle;
-    switch (protocol) {
-    case AITT_TYPE_MQTT:
-        subscribe_handle = SubscribeMQ(info, &main_loop, topic, cb, user_data, qos);
-        break;
-    case AITT_TYPE_TCP:
-    case AITT_TYPE_TCP_SECURE:
-        subscribe_handle = SubscribeTCP(info, topic, cb, user_data, qos);
-        break;
-    case AITT_TYPE_WEBRTC:
-        subscribe_handle = SubscribeWebRtc(info, topic, cb, user_data, qos);
-        break;
-    default:
+    if (protocol != AITT_TYPE_MQTT && protocol != AITT_TYPE_TCP
+          && protocol != AITT_TYPE_TCP_SECURE && protocol != AITT_TYPE_WEBRTC) {
         ERR("Unknown AittProtocol(%d)", protocol);
-        delete info;
         throw std::runtime_error("Unknown AittProtocol");
     }
-    info->second = subscribe_handle;
+
+    // The handle is reserved first, since received messages carry it as their ID
+    SlotMap<SubscribeInfo>::Handle handle;
+    {
+        std::unique_lock<std::mutex> lock(subscribed_list_mutex_);
+        handle = subscribed_list.Insert(SubscribeInfo(protocol, nullptr));
+    }
+    AittSubscribeID id = reinterpret_cast<AittSubscribeID>(handle);
+
+    void *subscribe_handle;
+    try {
+        switch (protocol) {
+        case AITT_TYPE_MQTT:
+            subscribe_handle = SubscribeMQ(id, topic, cb, user_data, qos, flags);
+            break;
+        case AITT_TYPE_WEBRTC:
+            subscribe_handle = SubscribeWebRtc(id, topic, cb, user_data, qos);
+            break;
+        default:
+            subscribe_handle = SubscribeTCP(id, protocol, topic, cb, user_data, qos);
+            break;
+        }
+    } catch (...) {
+        std::unique_lock<std::mutex> lock(subscribed_list_mutex_);
+        subscribed_list.Erase(handle);
+        throw;
+    }
+
+    bool removed;
     {
         std::unique_lock<std::mutex> lock(subscribed_list_mutex_);
-        subscribed_list.push_back(info);
+        SubscribeInfo *info = subscribed_list.Get(handle);
+        if (info)
+            info->second = subscribe_handle;
+        removed = (info == nullptr);
     }
 
-    INFO("Subscribe topic(%s) : %p", topic.c_str(), info);
-    return reinterpret_cast<AittSubscribeID>(info);
+    // Unsubscribe() or UnsubscribeAll() came in between, and skipped the transport
+    if (removed) {
+        if (protocol == AITT_TYPE_MQTT)
+            mq->Unsubscribe(subscribe_handle);
+        else
+            modules.Get(protocol).Unsubscribe(subscribe_handle);
+    }
+
+    INFO("Subscribe topic(%s) : %p", topic.c_str(), id);
+    return id;
 }
 
-AittSubscribeID AITT::Impl::SubscribeMQ(SubscribeInfo *handle, MainLoopHandler *loop_handle,
-      const std::string &topic, const SubscribeCallback &cb, void *user_data, AittQoS qos)
+AittSubscribeID AITT::Impl::SubscribeMQ(AittSubscribeID id, const std::string &topic,
+      const SubscribeCallback &cb, void *user_data, AittQoS qos, int flags)
 {
+    auto shared_cb = std::make_shared<SubscribeCallback>(cb);
+    DeliveryQueues *queues = NextDeliveryQueues();
+    EventQueue<Delivery> *queue =
+          (flags & AITT_SUBSCRIBE_HIGH_PRIORITY) ? &queues->high : &queues->normal;
     return mq->Subscribe(
           topic,
-          [this, handle, loop_handle, cb](MSG *msg, const std::string &topic, const void *data,
-                const size_t datalen, void *mq_user_data) {
+          [this, id, shared_cb, flags, queue](MSG *msg, const std::string &topic,
+                const void *data, const size_t datalen, void *mq_user_data) {
+              msg->SetID(id);
+              if (flags & AITT_SUBSCRIBE_INLINE) {
+                  (*shared_cb)(msg, data, datalen, mq_user_data);
+                  return;
+              }
+
+              if (flags & AITT_SUBSCRIBE_ZERO_COPY) {
+                  std::shared_ptr<void> shared_data = mq->SharePayload(data, datalen);
+                  void *delivery = shared_data.get();
+                  queue->Push(Delivery{shared_cb, std::move(*msg), delivery, datalen,
+                        mq_user_data, std::move(shared_data), nullptr});
+                  return;
+              }
+
               void *delivery = malloc(datalen);
               if (delivery)
                   memcpy(delivery, data, datalen);
 
-              msg->SetID(handle);
-              auto idler_cb =
-                    std::bind(&Impl::DetachedCB, this, cb, *msg, delivery, datalen, mq_user_data,
-                          std::placeholders::_1, std::placeholders::_2, std::placeholders::_3);
-              MainLoopHandler::AddIdle(loop_handle, idler_cb, nullptr);
+              queue->Push(Delivery{shared_cb, std::move(*msg), delivery, datalen, mq_user_data,
+                    nullptr, Buffer(delivery)});
           },
           user_data, qos);
 }
 
-void AITT::Impl::DetachedCB(SubscribeCallback cb, MSG msg, void *data, const size_t datalen,
-      void *user_data, MainLoopHandler::MainLoopResult result, int fd,
-      MainLoopHandler::MainLoopData *loop_data)
+AITT::Impl::DeliveryQueues *AITT::Impl::NextDeliveryQueues(void)
 {
-    RET_IF(cb == nullptr);
+    unsigned int index = next_worker++ % (workers.size() + 1);
+    if (index == 0)
+        return &delivery_queues;
 
-    cb(&msg, data, datalen, user_data);
+    return &workers[index - 1]->queues;
+}
 
-    free(data);
+void AITT::Impl::WatchDeliveries(MainLoopHandler &loop, DeliveryQueues &queues)
+{
+    auto deliver = [&queues](MainLoopHandler::MainLoopResult result, int fd,
+                         MainLoopHandler::MainLoopData *data) { DeliverMessages(queues); };
+    loop.AddWatch(queues.high.GetHandle(), deliver, nullptr);
+    loop.AddWatch(queues.normal.GetHandle(), deliver, nullptr);
+}
+
+// Weighted round robin, up to DELIVERY_HIGH_WEIGHT high priority deliveries for each of the
+// others. So a high priority message waits for a single callback at most, and a steady stream
+// of them does not starve the other subscriptions.
+void AITT::Impl::DeliverMessages(DeliveryQueues &queues)
+{
+    auto deliver = [](Delivery &delivery) {
+        if (delivery.cb && *delivery.cb)
+            (*delivery.cb)(&delivery.msg, delivery.data, delivery.datalen, delivery.user_data);
+        delivery.shared_data.reset();
+        delivery.buffer.reset();
+        delivery.cb.reset();
+    };
+
+    queues.high.Acknowledge();
+    queues.normal.Acknowledge();
+
+    size_t count = 0;
+    while (count < DELIVERY_BATCH_MAX) {
+        size_t delivered = queues.high.Pop(deliver, DELIVERY_HIGH_WEIGHT);
+        delivered += queues.normal.Pop(deliver, 1);
+        if (delivered == 0)
+            return;
+        count += delivered;
+    }
+
+    // Lets other event sources run in between, as EventQueue::Drain() does
+    queues.high.Wakeup();
+    queues.normal.Wakeup();
 }
 
 void *AITT::Impl::Unsubscribe(AittSubscribeID subscribe_id)
 {
     INFO("subscribe_id : %p", subscribe_id);
-    SubscribeInfo *info = reinterpret_cast<SubscribeInfo *>(subscribe_id);
-
     std::unique_lock<std::mutex> lock(subscribed_list_mutex_);
 
-    auto it = std::find(subscribed_list.begin(), subscribed_list.end(), info);
-    if (it == subscribed_list.end()) {
+    auto handle = reinterpret_cast<SlotMap<SubscribeInfo>::Handle>(subscribe_id);
+    SubscribeInfo info;
+    if (subscribed_list.Erase(handle, &info) == false) {
         ERR("Unknown subscribe_id(%p)", subscribe_id);
         throw std::runtime_error("subscribe_id");
     }
 
+    // Subscribe() has not finished yet, and unsubscribes it when it does
+    if (info.second == nullptr)
+        return nullptr;
+
     void *user_data = nullptr;
-    SubscribeInfo *found_info = *it;
-    switch (found_info->first) {
+    switch (info.first) {
     case AITT_TYPE_MQTT:
-        user_data = mq->Unsubscribe(found_info->second);
+        user_data = mq->Unsubscribe(info.second);
         break;
     case AITT_TYPE_TCP:
     case AITT_TYPE_TCP_SECURE:
     case AITT_TYPE_WEBRTC:
-        user_data = modules.Get(found_info->first).Unsubscribe(found_info->second);
+        user_data = modules.Get(info.first).Unsubscribe(info.second);
         break;
 
     default:
-        ERR("Unknown AittProtocol(%d)", found_info->first);
+        ERR("Unknown AittProtocol(%d)", info.first);
         break;
     }
 
-    subscribed_list.erase(it);
-    delete info;
-
     return user_data;
 }
 
@@ -287,11 +464,32 @@ int AITT::Impl::PublishWithReply(const std::string &topic, const void *data, con
       AittProtocol protocol, AittQoS qos, bool retain, const SubscribeCallback &cb, void *user_data,
       const std::string &correlation)
 {
-    std::string replyTopic = topic + RESPONSE_POSTFIX + std::to_string(reply_id++);
-
     if (protocol != AITT_TYPE_MQTT)
         return -1;  // not yet support
 
+    if (multiplex_reply) {
+        SubscribeReplyTopic();
+
+        unsigned int id = reply_id++;
+        {
+            std::lock_guard<std::mutex> lock(pending_replies_lock);
+            pending_replies[id] =
+                  PendingReply{std::make_shared<SubscribeCallback>(cb), user_data,
+                        &NextDeliveryQueues()->normal, nullptr, nullptr};
+        }
+
+        try {
+            mq->PublishWithReply(topic, data, datalen, qos, false,
+                  reply_topic_prefix + std::to_string(id), correlation);
+        } catch (std::exception &e) {
+            std::lock_guard<std::mutex> lock(pending_replies_lock);
+            pending_replies.erase(id);
+            throw;
+        }
+        return 0;
+    }
+
+    std::string replyTopic = topic + RESPONSE_POSTFIX + std::to_string(reply_id++);
     Subscribe(
           replyTopic,
           [this, cb](MSG *sub_msg, const void *sub_data, const size_t sub_datalen,
@@ -311,71 +509,242 @@ int AITT::Impl::PublishWithReply(const std::string &topic, const void *data, con
     return 0;
 }
 
+void AITT::Impl::SubscribeReplyTopic(void)
+{
+    std::lock_guard<std::mutex> lock(reply_topic_lock);
+    if (reply_topic_handle)
+        return;
+
+    // Replies can be sent with any QoS, so it does not downgrade them
+    reply_topic_handle = mq->Subscribe(
+          reply_topic_prefix + "+",
+          [this](MSG *msg, const std::string &topic, const void *data, const size_t datalen,
+                void *user_data) { RouteReply(msg, topic, data, datalen); },
+          nullptr, AITT_QOS_EXACTLY_ONCE);
+}
+
+void AITT::Impl::UnsubscribeReplyTopic(void)
+{
+    std::lock_guard<std::mutex> lock(reply_topic_lock);
+    if (reply_topic_handle) {
+        mq->Unsubscribe(reply_topic_handle);
+        reply_topic_handle = nullptr;
+    }
+
+    std::lock_guard<std::mutex> pending_lock(pending_replies_lock);
+    pending_replies.clear();
+}
+
+// Called on the MQ thread. The last level of the reply topic is the id of the request, since
+// correlation data is chosen by users and does not have to be unique.
+void AITT::Impl::RouteReply(MSG *msg, const std::string &topic, const void *data,
+      const size_t datalen)
+{
+    unsigned int id = strtoul(topic.c_str() + reply_topic_prefix.size(), nullptr, 10);
+
+    PendingReply pending;
+    {
+        std::lock_guard<std::mutex> lock(pending_replies_lock);
+        auto it = pending_replies.find(id);
+        if (it == pending_replies.end()) {
+            ERR("Unknown reply(%s)", topic.c_str());
+            return;
+        }
+
+        pending = it->second;
+        if (msg->IsEndSequence())
+            pending_replies.erase(it);
+
+        // Appended under the lock, since the request may expire concurrently
+        if (pending.collector) {
+            const char *begin = static_cast<const char *>(data);
+            pending.collector->replies.push_back(
+                  AITT::Reply{*msg, std::vector<char>(begin, begin + datalen)});
+        }
+    }
+
+    if (pending.collector) {
+        if (msg->IsEndSequence())
+            CompleteReply(*pending.collector);
+        return;
+    }
+
+    if (pending.waiter) {
+        pending.waiter->Push(msg, data, datalen);
+        return;
+    }
+
+    void *delivery = malloc(datalen);
+    if (delivery)
+        memcpy(delivery, data, datalen);
+
+    pending.queue->Push(Delivery{pending.cb, std::move(*msg), delivery, datalen,
+          pending.user_data, nullptr, Buffer(delivery)});
+}
+
+// Replies are always routed through the multiplexed reply topic, so that a fan-out of requests
+// costs a single subscription regardless of AittOption::SetMultiplexReply().
+std::future<std::vector<AITT::Reply>> AITT::Impl::PublishWithReplyAsync(const std::string &topic,
+      const void *data, const size_t datalen, AittProtocol protocol, AittQoS qos,
+      const std::string &correlation, int timeout_ms)
+{
+    if (protocol != AITT_TYPE_MQTT) {
+        ERR("Not supported protocol(%d)", protocol);
+        throw AittException(AittException::INVALID_ARG);
+    }
+
+    SubscribeReplyTopic();
+
+    auto collector = std::make_shared<ReplyCollector>();
+    collector->timeout_id = 0;
+    std::future<std::vector<AITT::Reply>> future = collector->promise.get_future();
+
+    unsigned int id = reply_id++;
+    {
+        std::lock_guard<std::mutex> lock(pending_replies_lock);
+        pending_replies[id] = PendingReply{nullptr, nullptr, nullptr, nullptr, collector};
+        if (timeout_ms) {
+            collector->timeout_id = main_loop.AddTimer(
+                  timeout_ms,
+                  [this, id, timeout_ms](MainLoopHandler::MainLoopResult result, int fd,
+                        MainLoopHandler::MainLoopData *loop_data) { ExpireReply(id, timeout_ms); },
+                  nullptr);
+        }
+    }
+
+    try {
+        mq->PublishWithReply(topic, data, datalen, qos, false,
+              reply_topic_prefix + std::to_string(id), correlation);
+    } catch (std::exception &e) {
+        std::lock_guard<std::mutex> lock(pending_replies_lock);
+        pending_replies.erase(id);
+        if (collector->timeout_id)
+            main_loop.RemoveTimer(collector->timeout_id);
+        throw;
+    }
+
+    return future;
+}
+
+// Called by the one who removed the request from pending_replies
+void AITT::Impl::CompleteReply(ReplyCollector &collector)
+{
+    if (collector.timeout_id)
+        main_loop.RemoveTimer(collector.timeout_id);
+
+    collector.promise.set_value(std::move(collector.replies));
+}
+
+void AITT::Impl::ExpireReply(unsigned int id, int timeout_ms)
+{
+    std::shared_ptr<ReplyCollector> collector;
+    {
+        std::lock_guard<std::mutex> lock(pending_replies_lock);
+        auto it = pending_replies.find(id);
+        if (it == pending_replies.end())
+            return;
+
+        collector = it->second.collector;
+        pending_replies.erase(it);
+    }
+
+    ERR("PublishWithReplyAsync() timeout(%d)", timeout_ms);
+    collector->promise.set_exception(
+          std::make_exception_ptr(AittException(AittException::TIMED_OUT_ERR)));
+}
+
 int AITT::Impl::PublishWithReplySync(const std::string &topic, const void *data,
       const size_t datalen, AittProtocol protocol, AittQoS qos, bool retain,
       const SubscribeCallback &cb, void *user_data, const std::string &correlation, int timeout_ms)
 {
-    std::string replyTopic = topic + RESPONSE_POSTFIX + std::to_string(reply_id++);
-
     if (protocol != AITT_TYPE_MQTT)
         return -1;  // not yet support
 
-    SubscribeInfo *info = new SubscribeInfo();
-    info->first = protocol;
+    // Replies are handed over from the MQ thread and the callback is invoked on this thread,
+    // so it needs neither a main loop nor a subscription per call.
+    auto waiter = std::make_shared<ReplyWaiter>();
+    unsigned int id = reply_id++;
+    std::string reply_topic;
+    void *reply_handle = nullptr;
 
-    void *subscribe_handle;
-    MainLoopHandler sync_loop;
-    unsigned int timeout_id = 0;
-    bool is_timeout = false;
+    if (multiplex_reply) {
+        SubscribeReplyTopic();
+        reply_topic = reply_topic_prefix + std::to_string(id);
 
-    subscribe_handle = SubscribeMQ(
-          info, &sync_loop, replyTopic,
-          [&](MSG *sub_msg, const void *sub_data, const size_t sub_datalen, void *sub_cbdata) {
-              if (sub_msg->IsEndSequence()) {
-                  try {
-                      Unsubscribe(sub_msg->GetID());
-                  } catch (std::runtime_error &e) {
-                      ERR("Unsubscribe() Fail(%s)", e.what());
-                  }
-                  sync_loop.Quit();
-              } else {
-                  if (timeout_id) {
-                      sync_loop.RemoveTimeout(timeout_id);
-                      HandleTimeout(timeout_ms, timeout_id, sync_loop, is_timeout);
-                  }
-              }
-              cb(sub_msg, sub_data, sub_datalen, sub_cbdata);
-          },
-          user_data, qos);
-    info->second = subscribe_handle;
-    {
-        std::unique_lock<std::mutex> lock(subscribed_list_mutex_);
-        subscribed_list.push_back(info);
+        std::lock_guard<std::mutex> lock(pending_replies_lock);
+        pending_replies[id] = PendingReply{nullptr, nullptr, nullptr, waiter, nullptr};
+    } else {
+        reply_topic = topic + RESPONSE_POSTFIX + std::to_string(id);
+        reply_handle = mq->Subscribe(
+              reply_topic,
+              [waiter](MSG *msg, const std::string &topic, const void *data, const size_t datalen,
+                    void *mq_user_data) { waiter->Push(msg, data, datalen); },
+              nullptr, qos);
     }
 
-    mq->PublishWithReply(topic, data, datalen, qos, false, replyTopic, correlation);
-    if (timeout_ms)
-        HandleTimeout(timeout_ms, timeout_id, sync_loop, is_timeout);
+    int ret;
+    try {
+        mq->PublishWithReply(topic, data, datalen, qos, false, reply_topic, correlation);
+        ret = WaitReplies(*waiter, cb, user_data, timeout_ms);
+    } catch (...) {
+        if (multiplex_reply) {
+            std::lock_guard<std::mutex> lock(pending_replies_lock);
+            pending_replies.erase(id);
+        } else {
+            mq->Unsubscribe(reply_handle);
+        }
+        throw;
+    }
 
-    sync_loop.Run();
+    if (multiplex_reply) {
+        std::lock_guard<std::mutex> lock(pending_replies_lock);
+        pending_replies.erase(id);
+    } else {
+        mq->Unsubscribe(reply_handle);
+    }
 
-    if (is_timeout)
-        return AITT_ERROR_TIMED_OUT;
-    return 0;
+    return ret;
 }
 
-void AITT::Impl::HandleTimeout(int timeout_ms, unsigned int &timeout_id,
-      aitt::MainLoopHandler &sync_loop, bool &is_timeout)
+void AITT::Impl::ReplyWaiter::Push(MSG *msg, const void *data, const size_t datalen)
 {
-    timeout_id = sync_loop.AddTimeout(
-          timeout_ms,
-          [&, timeout_ms](MainLoopHandler::MainLoopResult result, int fd,
-                MainLoopHandler::MainLoopData *data) {
-              ERR("PublishWithReplySync() timeout(%d)", timeout_ms);
-              sync_loop.Quit();
-              is_timeout = true;
-          },
-          nullptr);
+    const char *begin = static_cast<const char *>(data);
+
+    std::lock_guard<std::mutex> guard(lock);
+    replies.push_back(AITT::Reply{std::move(*msg), std::vector<char>(begin, begin + datalen)});
+    cond.notify_one();
+}
+
+// The timeout restarts whenever a part of the replies arrives.
+int AITT::Impl::WaitReplies(ReplyWaiter &waiter, const SubscribeCallback &cb, void *user_data,
+      int timeout_ms)
+{
+    auto has_reply = [&waiter]() { return waiter.replies.empty() == false; };
+
+    std::unique_lock<std::mutex> lock(waiter.lock);
+    while (true) {
+        if (timeout_ms) {
+            if (waiter.cond.wait_for(lock, std::chrono::milliseconds(timeout_ms), has_reply)
+                  == false) {
+                ERR("PublishWithReplySync() timeout(%d)", timeout_ms);
+                return AITT_ERROR_TIMED_OUT;
+            }
+        } else {
+            waiter.cond.wait(lock, has_reply);
+        }
+
+        AITT::Reply reply = std::move(waiter.replies.front());
+        waiter.replies.pop_front();
+        lock.unlock();
+
+        bool end = reply.msg.IsEndSequence();
+        if (cb)
+            cb(&reply.msg, reply.data.data(), reply.data.size(), user_data);
+        if (end)
+            return 0;
+
+        lock.lock();
+    }
 }
 
 void AITT::Impl::SendReply(MSG *msg, const void *data, const int datalen, bool end)
@@ -392,26 +761,27 @@ void AITT::Impl::SendReply(MSG *msg, const void *data, const int datalen, bool e
     mq->SendReply(msg, data, datalen, AITT_QOS_AT_MOST_ONCE, false);
 }
 
-void *AITT::Impl::SubscribeTCP(SubscribeInfo *handle, const std::string &topic,
-      const SubscribeCallback &cb, void *user_data, AittQoS qos)
+void *AITT::Impl::SubscribeTCP(AittSubscribeID id, AittProtocol protocol,
+      const std::string &topic, const SubscribeCallback &cb, void *user_data, AittQoS qos)
 {
-    return modules.Get(handle->first)
+    return modules.Get(protocol)
           .Subscribe(
                 topic,
-                [handle, cb](const std::string &topic, const void *data, const size_t datalen,
-                      void *user_data, const std::string &correlation) -> void {
+                [id, protocol, cb](const std::string &topic, const void *data,
+                      const size_t datalen, void *user_data,
+                      const std::string &correlation) -> void {
                     MSG msg;
-                    msg.SetID(handle);
+                    msg.SetID(id);
                     msg.SetTopic(topic);
                     msg.SetCorrelation(correlation);
-                    msg.SetProtocols(handle->first);
+                    msg.SetProtocols(protocol);
 
                     return cb(&msg, data, datalen, user_data);
                 },
                 user_data, qos);
 }
 
-void *AITT::Impl::SubscribeWebRtc(SubscribeInfo *handle, const std::string &topic,
+void *AITT::Impl::SubscribeWebRtc(AittSubscribeID id, const std::string &topic,
       const SubscribeCallback &cb, void *user_data, AittQoS qos)
 {
     flexbuffers::Builder fbb;
@@ -427,10 +797,10 @@ void *AITT::Impl::SubscribeWebRtc(SubscribeInfo *handle, const std::string &topi
     return modules.Get(AITT_TYPE_WEBRTC)
           .Subscribe(
                 topic,
-                [handle, cb](const std::string &topic, const void *data, const size_t datalen,
+                [id, cb](const std::string &topic, const void *data, const size_t datalen,
                       void *user_data, const std::string &correlation) -> void {
                     MSG msg;
-                    msg.SetID(handle);
+                    msg.SetID(id);
                     msg.SetTopic(topic);
                     msg.SetCorrelation(correlation);
                     msg.SetProtocols(AITT_TYPE_WEBRTC);
@@ -16,19 +16,27 @@
 #pragma once
 
 #include <flatbuffers/flexbuffers.h>
+#include <stdlib.h>
 
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <future>
 #include <map>
 #include <memory>
 #include <mutex>
 #include <string>
 #include <thread>
+#include <unordered_map>
 #include <utility>
 
 #include "AITT.h"
 #include "AittDiscovery.h"
+#include "EventQueue.h"
 #include "MQ.h"
 #include "MainLoopHandler.h"
 #include "ModuleManager.h"
+#include "SlotMap.h"
 
 namespace aitt {
 
@@ -41,6 +49,7 @@ class AITT::Impl {
     void SetWillInfo(const std::string &topic, const void *data, const size_t datalen, AittQoS qos,
           bool retain);
     void SetConnectionCallback(ConnectionCallback cb, void *user_data);
+    void SetPublishAckCallback(AITT::PublishAckCallback cb, void *user_data);
     void Connect(const std::string &host, int port, const std::string &username,
           const std::string &password);
     void Disconnect(void);
@@ -50,15 +59,19 @@ class AITT::Impl {
 
     void Publish(const std::string &topic, const void *data, const size_t datalen,
           AittProtocol protocols, AittQoS qos, bool retain);
+    void PublishBatch(const std::vector<AittPublishEntry> &entries, AittProtocol protocols);
     int PublishWithReply(const std::string &topic, const void *data, const size_t datalen,
           AittProtocol protocol, AittQoS qos, bool retain, const AITT::SubscribeCallback &cb,
           void *cbdata, const std::string &correlation);
     int PublishWithReplySync(const std::string &topic, const void *data, const size_t datalen,
           AittProtocol protocol, AittQoS qos, bool retain, const SubscribeCallback &cb,
           void *cbdata, const std::string &correlation, int timeout_ms);
+    std::future<std::vector<AITT::Reply>> PublishWithReplyAsync(const std::string &topic,
+          const void *data, const size_t datalen, AittProtocol protocol, AittQoS qos,
+          const std::string &correlation, int timeout_ms);
 
     AittSubscribeID Subscribe(const std::string &topic, const AITT::SubscribeCallback &cb,
-          void *cbdata, AittProtocol protocols, AittQoS qos);
+          void *cbdata, AittProtocol protocols, AittQoS qos, int flags = AITT_SUBSCRIBE_DEFAULT);
     void *Unsubscribe(AittSubscribeID handle);
 
     void SendReply(MSG *msg, const void *data, const int datalen, bool end);
@@ -67,19 +80,89 @@ class AITT::Impl {
     using Blob = std::pair<const void *, int>;
     using SubscribeInfo = std::pair<AittProtocol, void *>;
 
+    struct FreeDeleter {
+        void operator()(void *data) const { free(data); }
+    };
+    using Buffer = std::unique_ptr<void, FreeDeleter>;
+
+    // Message handed over from the MQ thread to the AITT worker thread. It owns data through
+    // either buffer or shared_data, so deliveries still queued at teardown are released too.
+    struct Delivery {
+        std::shared_ptr<SubscribeCallback> cb;
+        MSG msg;
+        void *data;
+        size_t datalen;
+        void *user_data;
+        std::shared_ptr<void> shared_data;  // see AITT_SUBSCRIBE_ZERO_COPY
+        Buffer buffer;                      // copy of the payload
+    };
+
+    // Replies of a PublishWithReplySync() call, consumed on the calling thread
+    struct ReplyWaiter {
+        void Push(MSG *msg, const void *data, const size_t datalen);
+
+        std::mutex lock;
+        std::condition_variable cond;
+        std::deque<AITT::Reply> replies;
+    };
+
+    // Replies of a PublishWithReplyAsync() call, handed to the future at the end of sequence
+    struct ReplyCollector {
+        std::promise<std::vector<AITT::Reply>> promise;
+        std::vector<AITT::Reply> replies;
+        MainLoopHandler::TimerID timeout_id;
+    };
+
+    // Request waiting for replies on the multiplexed reply topic
+    struct PendingReply {
+        std::shared_ptr<SubscribeCallback> cb;
+        void *user_data;
+        EventQueue<Delivery> *queue;
+        std::shared_ptr<ReplyWaiter> waiter;  // replaces queue for synchronous requests
+        std::shared_ptr<ReplyCollector> collector;  // replaces queue for future requests
+    };
+
+    // Deliveries to the callbacks of a thread, see AITT_SUBSCRIBE_HIGH_PRIORITY
+    struct DeliveryQueues {
+        EventQueue<Delivery> high;
+        EventQueue<Delivery> normal;
+    };
+
+    // Additional thread invoking subscribe callbacks, see AittOption::SetCallbackThreads()
+    class Worker {
+      public:
+        explicit Worker(int index);
+        ~Worker(void);
+
+        DeliveryQueues queues;
+
+      private:
+        void ThreadMain(int index);
+
+        MainLoopHandler loop;
+        std::thread thread;
+    };
+
+    static std::unique_ptr<MQ> NewMosquittoMQ(const std::string &id, const AittOption &option);
     void ConnectionCB(ConnectionCallback cb, void *user_data, int status);
-    AittSubscribeID SubscribeMQ(SubscribeInfo *info, MainLoopHandler *loop_handle,
-          const std::string &topic, const SubscribeCallback &cb, void *cbdata, AittQoS qos);
-    void DetachedCB(SubscribeCallback cb, MSG mq_msg, void *data, const size_t datalen,
-          void *cbdata, MainLoopHandler::MainLoopResult result, int fd,
-          MainLoopHandler::MainLoopData *loop_data);
-    void *SubscribeTCP(SubscribeInfo *, const std::string &topic, const SubscribeCallback &cb,
-          void *cbdata, AittQoS qos);
-
-    void *SubscribeWebRtc(SubscribeInfo *, const std::string &topic, const SubscribeCallback &cb,
-          void *cbdata, AittQoS qos);
-    void HandleTimeout(int timeout_ms, unsigned int &timeout_id, aitt::MainLoopHandler &sync_loop,
-          bool &is_timeout);
+    AittSubscribeID SubscribeMQ(AittSubscribeID id, const std::string &topic,
+          const SubscribeCallback &cb, void *cbdata, AittQoS qos,
+          int flags = AITT_SUBSCRIBE_DEFAULT);
+    DeliveryQueues *NextDeliveryQueues(void);
+    void SubscribeReplyTopic(void);
+    void UnsubscribeReplyTopic(void);
+    void RouteReply(MSG *msg, const std::string &topic, const void *data, const size_t datalen);
+    void CompleteReply(ReplyCollector &collector);
+    void ExpireReply(unsigned int id, int timeout_ms);
+    static void WatchDeliveries(MainLoopHandler &loop, DeliveryQueues &queues);
+    static void DeliverMessages(DeliveryQueues &queues);
+    void *SubscribeTCP(AittSubscribeID id, AittProtocol protocol, const std::string &topic,
+          const SubscribeCallback &cb, void *cbdata, AittQoS qos);
+
+    void *SubscribeWebRtc(AittSubscribeID id, const std::string &topic,
+          const SubscribeCallback &cb, void *cbdata, AittQoS qos);
+    int WaitReplies(ReplyWaiter &waiter, const SubscribeCallback &cb, void *cbdata,
+          int timeout_ms);
     void PublishWebRtc(const std::string &topic, const void *data, const size_t datalen,
           AittQoS qos, bool retain);
     void UnsubscribeAll();
@@ -88,16 +171,27 @@ class AITT::Impl {
     AITT &public_api;
     AittDiscovery discovery;
     MainLoopHandler main_loop;
+    DeliveryQueues delivery_queues;
     std::thread aittThread;
     ModuleManager modules;
     std::unique_ptr<MQ> mq;
-    std::vector<SubscribeInfo *> subscribed_list;
+    std::vector<std::unique_ptr<Worker>> workers;
+    std::atomic<unsigned int> next_worker;
+    SlotMap<SubscribeInfo> subscribed_list;
     std::mutex subscribed_list_mutex_;
 
     std::string id_;
     std::string mqtt_broker_ip_;
     int mqtt_broker_port_;
-    unsigned short reply_id;
+    std::atomic<unsigned int> reply_id;
+
+    bool multiplex_reply;
+    std::string reply_topic_prefix;
+    void *reply_topic_handle;
+    std::mutex reply_topic_lock;
+    std::unordered_map<unsigned int, PendingReply> pending_replies;
+    std::mutex pending_replies_lock;
+    bool shared_discovery;  // the discovery runs over mq
 };
 
 }  // namespace aitt
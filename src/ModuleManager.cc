@@ -23,12 +23,13 @@
 
 namespace aitt {
 
-ModuleManager::ModuleManager(const std::string &my_ip, AittDiscovery &d)
+ModuleManager::ModuleManager(const std::string &my_ip, AittDiscovery &d,
+      const AittOption &option)
       : ip(my_ip), discovery(d), custom_mqtt_handle(nullptr, nullptr), null_transport(discovery, ip)
 {
     for (int i = TYPE_TCP; i < TYPE_TRANSPORT_MAX; ++i) {
         transport_handles.push_back(ModuleHandle(nullptr, nullptr));
-        LoadTransport(static_cast<TransportType>(i));
+        LoadTransport(static_cast<TransportType>(i), option);
     }
 }
 
@@ -99,7 +100,7 @@ ModuleManager::ModuleHandle ModuleManager::OpenTransport(TransportType type)
     return handle;
 }
 
-void ModuleManager::LoadTransport(TransportType type)
+void ModuleManager::LoadTransport(TransportType type, const AittOption &option)
 {
     transport_handles[type] = OpenTransport(type);
     if (transport_handles[type] == nullptr) {
@@ -116,7 +117,7 @@ void ModuleManager::LoadTransport(TransportType type)
 
     AittProtocol protocol = static_cast<AittProtocol>(0x1 << (type + 1));
     transports[type] = std::unique_ptr<AittTransport>(
-          static_cast<AittTransport *>(get_instance_fn(protocol, discovery, ip.c_str())));
+          static_cast<AittTransport *>(get_instance_fn(protocol, discovery, ip.c_str(), option)));
     if (transports[type] == nullptr) {
         ERR("get_instance_fn(%d) Fail", protocol);
     }
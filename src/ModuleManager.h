@@ -28,7 +28,9 @@ namespace aitt {
 
 class ModuleManager {
   public:
-    explicit ModuleManager(const std::string &my_ip, AittDiscovery &d);
+    // option is passed to the transport modules when they are loaded
+    explicit ModuleManager(const std::string &my_ip, AittDiscovery &d,
+          const AittOption &option = AittOption());
     virtual ~ModuleManager() = default;
 
     AittTransport &Get(AittProtocol type);
@@ -49,7 +51,7 @@ class ModuleManager {
     std::string GetTransportFileName(TransportType type);
     ModuleHandle OpenModule(const char *file);
     ModuleHandle OpenTransport(TransportType type);
-    void LoadTransport(TransportType type);
+    void LoadTransport(TransportType type, const AittOption &option);
 
     std::string ip;
     AittDiscovery &discovery;
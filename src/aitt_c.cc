@@ -250,7 +250,12 @@ API int aitt_publish_full(aitt_h handle, const char *topic, const void *msg, con
     RETV_IF(msg == nullptr, AITT_ERROR_INVALID_PARAMETER);
 
     try {
-        handle->aitt->Publish(topic, msg, msg_len, AITT_TYPE_MQTT);
+        handle->aitt->Publish(topic, msg, msg_len, static_cast<AittProtocol>(protocols), qos);
+    } catch (aitt::AittException &e) {
+        ERR("Publish(topic:%s, msg_len:%zu) Fail(%s)", topic, msg_len, e.what());
+        if (e.getErrCode() == aitt::AittException::WOULD_BLOCK_ERR)
+            return AITT_ERROR_WOULD_BLOCK;
+        return AITT_ERROR_SYSTEM;
     } catch (std::exception &e) {
         ERR("Publish(topic:%s, msg_len:%zu) Fail(%s)", topic, msg_len, e.what());
         return AITT_ERROR_SYSTEM;
@@ -259,6 +264,35 @@ API int aitt_publish_full(aitt_h handle, const char *topic, const void *msg, con
     return AITT_ERROR_NONE;
 }
 
+API int aitt_publish_batch(aitt_h handle, const aitt_publish_entry_s *entries, size_t count,
+      int protocols)
+{
+    RETV_IF(handle == nullptr, AITT_ERROR_INVALID_PARAMETER);
+    RETV_IF(handle->aitt == nullptr, AITT_ERROR_INVALID_PARAMETER);
+    RETV_IF(handle->connected == false, AITT_ERROR_NOT_READY);
+    RETV_IF(entries == nullptr, AITT_ERROR_INVALID_PARAMETER);
+
+    for (size_t i = 0; i < count; i++) {
+        RETV_IF(entries[i].topic == nullptr, AITT_ERROR_INVALID_PARAMETER);
+        RETV_IF(entries[i].data == nullptr && entries[i].datalen, AITT_ERROR_INVALID_PARAMETER);
+    }
+
+    try {
+        handle->aitt->PublishBatch(std::vector<AittPublishEntry>(entries, entries + count),
+              static_cast<AittProtocol>(protocols));
+    } catch (aitt::AittException &e) {
+        ERR("PublishBatch(count:%zu) Fail(%s)", count, e.what());
+        if (e.getErrCode() == aitt::AittException::WOULD_BLOCK_ERR)
+            return AITT_ERROR_WOULD_BLOCK;
+        return AITT_ERROR_SYSTEM;
+    } catch (std::exception &e) {
+        ERR("PublishBatch(count:%zu) Fail(%s)", count, e.what());
+        return AITT_ERROR_SYSTEM;
+    }
+
+    return AITT_ERROR_NONE;
+}
+
 API int aitt_publish_with_reply(aitt_h handle, const char *topic, const void *msg,
       const size_t msg_len, aitt_protocol_e protocols, aitt_qos_e qos, const char *correlation,
       aitt_sub_fn cb, void *user_data)
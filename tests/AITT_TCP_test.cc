@@ -16,7 +16,11 @@
 #include <glib.h>
 #include <gtest/gtest.h>
 
+#include <memory>
+#include <mutex>
+#include <string>
 #include <thread>
+#include <vector>
 
 #include "AITT.h"
 #include "AittTests.h"
@@ -121,3 +125,102 @@ TEST_F(AITTTCPTest, SECURE_TCP_Wildcards_Anytime)
 {
     TCPWildcardsTopicTemplate(AITT_TYPE_TCP_SECURE);
 }
+
+TEST_F(AITTTCPTest, TCP_Shared_Discovery_Anytime)
+{
+    try {
+        char dump_msg[204800];
+
+        AittOption option(true, false);
+        option.SetSharedDiscovery(true);
+        AITT subscriber(clientId + "sub", LOCAL_IP, option);
+        AITT publisher(clientId + "pub", LOCAL_IP, option);
+        subscriber.Connect();
+        publisher.Connect();
+
+        subscriber.Subscribe(
+              "test/shared",
+              [&](aitt::MSG *handle, const void *msg, const size_t szmsg, void *cbdata) -> void {
+                  AITTTCPTest *test = static_cast<AITTTCPTest *>(cbdata);
+                  INFO("Got Message(Topic:%s, size:%zu)", handle->GetTopic().c_str(), szmsg);
+                  test->ToggleReady();
+              },
+              static_cast<void *>(this), AITT_TYPE_TCP);
+
+        // The discovery messages go through the data connections
+        DBG("Sleep %d secs", SLEEP_MS);
+        sleep(SLEEP_MS);
+
+        publisher.Publish("test/shared", dump_msg, 12, AITT_TYPE_TCP);
+
+        g_timeout_add(10, AittTests::ReadyCheck, static_cast<AittTests *>(this));
+
+        IterateEventLoop();
+
+        ASSERT_TRUE(ready);
+    } catch (std::exception &e) {
+        FAIL() << "Unexpected exception: " << e.what();
+    }
+}
+
+TEST_F(AITTTCPTest, TCP_Reactor_Threads_Anytime)
+{
+    try {
+        const int publishers = 3;
+        const int count = 100;
+
+        AittOption option(true, false);
+        option.SetTCPReactorThreads(publishers);
+        AITT subscriber(clientId + "sub", LOCAL_IP, option);
+        subscriber.Connect();
+
+        // Connections are received on different threads, each of them in order
+        std::mutex lock;
+        std::vector<int> next(publishers, 0);
+        int received = 0;
+        subscriber.Subscribe(
+              "test/reactor",
+              [&](aitt::MSG *handle, const void *msg, const size_t szmsg, void *cbdata) -> void {
+                  AITTTCPTest *test = static_cast<AITTTCPTest *>(cbdata);
+                  ASSERT_EQ(szmsg, sizeof(int) * 2);
+                  int sequence[2];
+                  memcpy(sequence, msg, sizeof(sequence));
+
+                  std::lock_guard<std::mutex> guard(lock);
+                  EXPECT_EQ(sequence[1], next[sequence[0]]++);
+                  if (++received == publishers * count)
+                      test->ToggleReady();
+              },
+              static_cast<void *>(this), AITT_TYPE_TCP);
+
+        std::vector<std::unique_ptr<AITT>> clients;
+        for (int i = 0; i < publishers; i++) {
+            clients.emplace_back(new AITT(clientId + "pub" + std::to_string(i), LOCAL_IP));
+            clients.back()->Connect();
+        }
+
+        DBG("Sleep %d secs", SLEEP_MS);
+        sleep(SLEEP_MS);
+
+        std::vector<std::thread> threads;
+        for (int i = 0; i < publishers; i++) {
+            threads.emplace_back([&, i]() {
+                for (int j = 0; j < count; j++) {
+                    int sequence[2] = {i, j};
+                    clients[i]->Publish("test/reactor", sequence, sizeof(sequence),
+                          AITT_TYPE_TCP);
+                }
+            });
+        }
+        for (auto &thread : threads)
+            thread.join();
+
+        g_timeout_add(10, AittTests::ReadyCheck, static_cast<AittTests *>(this));
+
+        IterateEventLoop();
+
+        ASSERT_TRUE(ready);
+    } catch (std::exception &e) {
+        FAIL() << "Unexpected exception: " << e.what();
+    }
+}
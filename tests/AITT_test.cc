@@ -18,7 +18,10 @@
 #include <glib.h>
 #include <gtest/gtest.h>
 
+#include <algorithm>
+#include <mutex>
 #include <random>
+#include <set>
 
 #include "AittTests.h"
 #include "aitt_internal.h"
@@ -64,6 +67,49 @@ class AITTTest : public testing::Test, public AittTests {
         }
     }
 
+    void PublishBatchTemplate(AittProtocol protocol)
+    {
+        try {
+            AITT aitt(clientId, LOCAL_IP, AittOption(true, false));
+            aitt.Connect();
+
+            std::vector<std::string> received;
+            aitt.Subscribe(
+                  testTopic,
+                  [&](aitt::MSG *handle, const void *msg, const size_t szmsg,
+                        void *cbdata) -> void {
+                      AITTTest *test = static_cast<AITTTest *>(cbdata);
+                      received.push_back(std::string(static_cast<const char *>(msg), szmsg));
+                      if (received.size() == 2)
+                          test->ToggleReady();
+                  },
+                  static_cast<void *>(this), protocol);
+
+            // Wait a few seconds until the AITT client gets a server list (discover devices)
+            DBG("Sleep %d secs", SLEEP_MS);
+            sleep(SLEEP_MS);
+
+            std::string other_topic = testTopic + "/other";
+            std::vector<AittPublishEntry> entries = {
+                  {testTopic.c_str(), TEST_MSG, strlen(TEST_MSG), AITT_QOS_AT_MOST_ONCE},
+                  {other_topic.c_str(), TEST_MSG, strlen(TEST_MSG), AITT_QOS_AT_MOST_ONCE},
+                  {testTopic.c_str(), TEST_MSG2, strlen(TEST_MSG2), AITT_QOS_AT_LEAST_ONCE},
+            };
+            aitt.PublishBatch(entries, protocol);
+
+            g_timeout_add(10, AittTests::ReadyCheck, static_cast<AittTests *>(this));
+
+            IterateEventLoop();
+
+            ASSERT_TRUE(ready);
+            ASSERT_EQ(received.size(), 2);
+            EXPECT_EQ(received[0], TEST_MSG);
+            EXPECT_EQ(received[1], TEST_MSG2);
+        } catch (std::exception &e) {
+            FAIL() << "Unexpected exception: " << e.what();
+        }
+    }
+
     void PublishDisconnectTemplate(AittProtocol protocol)
     {
         const char character_set[] =
@@ -416,6 +462,31 @@ TEST_F(AITTTest, Unsubscribe_MQTT_P_Anytime)
     }
 }
 
+TEST_F(AITTTest, Unsubscribe_Stale_Handle_N_Anytime)
+{
+    try {
+        AITT aitt(clientId, LOCAL_IP, AittOption(true, false));
+        aitt.Connect();
+        AittSubscribeID stale = aitt.Subscribe(
+              testTopic,
+              [](aitt::MSG *handle, const void *msg, const size_t szmsg, void *cbdata) -> void {},
+              nullptr, AITT_TYPE_MQTT);
+        aitt.Unsubscribe(stale);
+
+        // The new subscription may reuse the slot of the stale one
+        subscribeHandle = aitt.Subscribe(
+              testTopic,
+              [](aitt::MSG *handle, const void *msg, const size_t szmsg, void *cbdata) -> void {},
+              nullptr, AITT_TYPE_MQTT);
+        EXPECT_NE(stale, subscribeHandle);
+        EXPECT_THROW(aitt.Unsubscribe(stale), std::runtime_error);
+        EXPECT_THROW(aitt.Unsubscribe(nullptr), std::runtime_error);
+        aitt.Unsubscribe(subscribeHandle);
+    } catch (std::exception &e) {
+        FAIL() << "Unexpected exception: " << e.what();
+    }
+}
+
 TEST_F(AITTTest, Unsubscribe_TCP_P_Anytime)
 {
     try {
@@ -458,6 +529,169 @@ TEST_F(AITTTest, Positve_Publish_0_MQTT_Anytime)
     PubsubTemplate("", AITT_TYPE_MQTT);
 }
 
+TEST_F(AITTTest, PublishSubscribe_ZeroCopy_MQTT_P_Anytime)
+{
+    try {
+        AITT aitt(clientId, LOCAL_IP, AittOption(true, false));
+        aitt.Connect();
+
+        int zero_copy_cnt = 0;
+        int copy_cnt = 0;
+        for (int flags : {AITT_SUBSCRIBE_ZERO_COPY, AITT_SUBSCRIBE_ZERO_COPY,
+                   AITT_SUBSCRIBE_DEFAULT}) {
+            int &cnt = (flags == AITT_SUBSCRIBE_ZERO_COPY) ? zero_copy_cnt : copy_cnt;
+            aitt.Subscribe(
+                  testTopic,
+                  [&](aitt::MSG *handle, const void *msg, const size_t szmsg, void *cbdata) {
+                      AITTTest *test = static_cast<AITTTest *>(cbdata);
+                      ASSERT_EQ(szmsg, sizeof(TEST_MSG));
+                      ASSERT_STREQ(static_cast<const char *>(msg), TEST_MSG);
+                      ++cnt;
+                      if (zero_copy_cnt == 2 && copy_cnt == 1)
+                          test->ToggleReady();
+                  },
+                  static_cast<void *>(this), AITT_TYPE_MQTT, AITT_QOS_AT_MOST_ONCE, flags);
+        }
+
+        aitt.Publish(testTopic, TEST_MSG, sizeof(TEST_MSG));
+
+        g_timeout_add(10, AittTests::ReadyCheck, static_cast<AittTests *>(this));
+
+        IterateEventLoop();
+
+        ASSERT_TRUE(ready);
+    } catch (std::exception &e) {
+        FAIL() << "Unexpected exception: " << e.what();
+    }
+}
+
+TEST_F(AITTTest, PublishSubscribe_Inline_MQTT_P_Anytime)
+{
+    try {
+        AITT aitt(clientId, LOCAL_IP, AittOption(true, false));
+        aitt.Connect();
+        aitt.Subscribe(
+              testTopic,
+              [](aitt::MSG *handle, const void *msg, const size_t szmsg, void *cbdata) {
+                  AITTTest *test = static_cast<AITTTest *>(cbdata);
+                  char name[16] = {0};
+                  pthread_getname_np(pthread_self(), name, sizeof(name));
+                  EXPECT_STRNE(name, "AITTWorkerLoop");
+                  EXPECT_STREQ(static_cast<const char *>(msg), TEST_MSG);
+                  test->ToggleReady();
+              },
+              static_cast<void *>(this), AITT_TYPE_MQTT, AITT_QOS_AT_MOST_ONCE,
+              AITT_SUBSCRIBE_INLINE);
+
+        aitt.Publish(testTopic, TEST_MSG, sizeof(TEST_MSG));
+
+        g_timeout_add(10, AittTests::ReadyCheck, static_cast<AittTests *>(this));
+
+        IterateEventLoop();
+
+        ASSERT_TRUE(ready);
+    } catch (std::exception &e) {
+        FAIL() << "Unexpected exception: " << e.what();
+    }
+}
+
+TEST_F(AITTTest, PublishSubscribe_HighPriority_MQTT_P_Anytime)
+{
+    const size_t bulk_messages = 100;
+
+    try {
+        AITT aitt(clientId, LOCAL_IP, AittOption(true, false));
+        aitt.Connect();
+
+        std::mutex lock;
+        std::vector<std::string> order;
+        auto receive = [&](const std::string &name) {
+            std::lock_guard<std::mutex> auto_lock(lock);
+            order.push_back(name);
+            if (order.size() == bulk_messages + 1)
+                ToggleReady();
+        };
+
+        // The first bulk message holds the worker thread, until the others and the control
+        // message are queued behind it
+        aitt.Subscribe(testTopic + "/bulk",
+              [&](aitt::MSG *handle, const void *msg, const size_t szmsg, void *cbdata) {
+                  if (*static_cast<const int *>(msg) == 0)
+                      usleep(500000);
+                  receive("bulk");
+              });
+        aitt.Subscribe(
+              testTopic + "/control",
+              [&](aitt::MSG *handle, const void *msg, const size_t szmsg, void *cbdata) {
+                  receive("control");
+              },
+              nullptr, AITT_TYPE_MQTT, AITT_QOS_AT_MOST_ONCE, AITT_SUBSCRIBE_HIGH_PRIORITY);
+
+        for (size_t i = 0; i < bulk_messages; i++) {
+            int sequence = i;
+            aitt.Publish(testTopic + "/bulk", &sequence, sizeof(sequence));
+        }
+        aitt.Publish(testTopic + "/control", TEST_MSG, sizeof(TEST_MSG));
+
+        g_timeout_add(10, AittTests::ReadyCheck, static_cast<AittTests *>(this));
+
+        IterateEventLoop();
+
+        ASSERT_TRUE(ready);
+        std::lock_guard<std::mutex> auto_lock(lock);
+        size_t position = std::find(order.begin(), order.end(), "control") - order.begin();
+        EXPECT_LT(position, bulk_messages);
+    } catch (std::exception &e) {
+        FAIL() << "Unexpected exception: " << e.what();
+    }
+}
+
+TEST_F(AITTTest, CallbackThreads_MQTT_P_Anytime)
+{
+    const int threads = 4;
+    const int messages = 100;
+
+    try {
+        AittOption option(true, false);
+        option.SetCallbackThreads(threads);
+        AITT aitt(clientId, LOCAL_IP, option);
+        aitt.Connect();
+
+        std::mutex lock;
+        std::set<pthread_t> thread_ids;
+        std::vector<int> next(threads, 0);
+        int received = 0;
+        for (int i = 0; i < threads; i++) {
+            aitt.Subscribe(
+                  testTopic + "/" + std::to_string(i),
+                  [&, i](aitt::MSG *handle, const void *msg, const size_t szmsg, void *cbdata) {
+                      AITTTest *test = static_cast<AITTTest *>(cbdata);
+                      std::lock_guard<std::mutex> auto_lock(lock);
+                      EXPECT_EQ(*static_cast<const int *>(msg), next[i]);
+                      next[i]++;
+                      thread_ids.insert(pthread_self());
+                      if (++received == threads * messages)
+                          test->ToggleReady();
+                  },
+                  static_cast<void *>(this));
+        }
+
+        for (int seq = 0; seq < messages; seq++) {
+            for (int i = 0; i < threads; i++)
+                aitt.Publish(testTopic + "/" + std::to_string(i), &seq, sizeof(seq));
+        }
+
+        g_timeout_add(10, AittTests::ReadyCheck, static_cast<AittTests *>(this));
+
+        IterateEventLoop();
+
+        ASSERT_TRUE(ready);
+        EXPECT_EQ(thread_ids.size(), static_cast<size_t>(threads));
+    } catch (std::exception &e) {
+        FAIL() << "Unexpected exception: " << e.what();
+    }
+}
+
 TEST_F(AITTTest, Unsubscribe_in_Subscribe_MQTT_P_Anytime)
 {
     try {
@@ -604,6 +838,21 @@ TEST_F(AITTTest, PublishSubscribe_Multiple_Protocols_P_Anytime)
     }
 }
 
+TEST_F(AITTTest, PublishBatch_MQTT_P_Anytime)
+{
+    PublishBatchTemplate(AITT_TYPE_MQTT);
+}
+
+TEST_F(AITTTest, PublishBatch_TCP_P_Anytime)
+{
+    PublishBatchTemplate(AITT_TYPE_TCP);
+}
+
+TEST_F(AITTTest, PublishBatch_SECURE_TCP_P_Anytime)
+{
+    PublishBatchTemplate(AITT_TYPE_TCP_SECURE);
+}
+
 TEST_F(AITTTest, PublishSubscribe_TCP_twice_P_Anytime)
 {
     PublishSubscribeTCPTwiceTemplate(AITT_TYPE_TCP);
@@ -645,3 +894,12 @@ TEST_F(AITTTest, WillSet_N_Anytime)
           },
           std::exception);
 }
+
+TEST_F(AITTTest, WillSet_Shared_Discovery_N_Anytime)
+{
+    AittOption option(true, false);
+    option.SetSharedDiscovery(true);
+    AITT aitt_will(clientId, LOCAL_IP, option);
+    EXPECT_THROW(aitt_will.SetWillInfo(testTopic, "will msg", 8, AITT_QOS_AT_MOST_ONCE, false),
+          std::exception);
+}
@@ -0,0 +1,57 @@
+/*
+ * Copyright (c) 2022 Samsung Electronics Co., Ltd All Rights Reserved
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "AittUtil.h"
+
+#include <gtest/gtest.h>
+
+using TopicFilter = aitt::AittUtil::TopicFilter;
+
+static const char *FILTERS[] = {"a", "a/b", "a/+", "a/#", "#", "+", "+/+", "a/+/c", "$SYS/#",
+      "+/info", "a/", "/a", "+/#", "/+"};
+static const char *TOPICS[] = {"a", "a/b", "a/b/c", "a/", "/a", "$SYS/info", "b/info", "a//c",
+      "a/x/c", "/", "x"};
+
+TEST(AittUtilTest, TopicFilter_Same_As_CompareTopic_P_Anytime)
+{
+    for (const char *filter : FILTERS) {
+        TopicFilter topic_filter(filter);
+        for (const char *topic : TOPICS) {
+            EXPECT_EQ(topic_filter.Match(topic), aitt::AittUtil::CompareTopic(filter, topic))
+                  << "filter(" << filter << "), topic(" << topic << ")";
+        }
+    }
+}
+
+TEST(AittUtilTest, TopicFilter_P_Anytime)
+{
+    EXPECT_TRUE(TopicFilter("a/b").Match("a/b"));
+    EXPECT_FALSE(TopicFilter("a/b").Match("a/bc"));
+    EXPECT_TRUE(TopicFilter("a/#").Match("a"));
+    EXPECT_TRUE(TopicFilter("a/+/c").Match("a//c"));
+    EXPECT_FALSE(TopicFilter("#").Match("$SYS/info"));
+    EXPECT_EQ(TopicFilter("a/+").GetFilter(), "a/+");
+    // Only the given length of the topic is matched
+    EXPECT_TRUE(TopicFilter("a/b").Match("a/b/c", 3));
+    EXPECT_TRUE(TopicFilter("a/+").Match("a/b/c", 3));
+    EXPECT_FALSE(TopicFilter("a/+/c").Match("a/b/c", 3));
+}
+
+TEST(AittUtilTest, TopicFilter_Invalid_N_Anytime)
+{
+    EXPECT_FALSE(TopicFilter("a/#/b").Match("a/x/b"));
+    EXPECT_FALSE(TopicFilter("a+").Match("a+"));
+    EXPECT_FALSE(TopicFilter("").Match(""));
+}
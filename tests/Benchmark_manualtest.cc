@@ -0,0 +1,415 @@
+/*
+ * Copyright (c) 2022 Samsung Electronics Co., Ltd All Rights Reserved
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <gtest/gtest.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "AITT.h"
+#include "AittTests.h"
+#include "AittUtil.h"
+#include "MainLoopHandler.h"
+#include "aitt_internal.h"
+
+using AITT = aitt::AITT;
+using MainLoopHandler = aitt::MainLoopHandler;
+
+class BenchmarkManualTest : public testing::Test, public AittTests {
+  protected:
+    void SetUp() override { Init(); }
+    void TearDown() override { Deinit(); }
+
+    void WaitReceived(int expected)
+    {
+        std::unique_lock<std::mutex> lock(received_lock);
+        bool done = received_cond.wait_for(lock, std::chrono::seconds(30),
+              [&]() { return received >= expected; });
+        ASSERT_TRUE(done) << "received " << received << "/" << expected;
+    }
+
+    void Received(void)
+    {
+        std::lock_guard<std::mutex> lock(received_lock);
+        received++;
+        received_cond.notify_one();
+    }
+
+    // Returns the time in milliseconds to receive 'count' messages of 'size' bytes
+    double ReceiveThroughput(int flags, int count, size_t size)
+    {
+        AITT aitt(clientId + std::to_string(flags), LOCAL_IP, AittOption(true, false));
+        aitt.Connect();
+
+        received = 0;
+        aitt.Subscribe(
+              testTopic,
+              [](aitt::MSG *handle, const void *msg, const size_t szmsg, void *cbdata) {
+                  BenchmarkManualTest *test = static_cast<BenchmarkManualTest *>(cbdata);
+                  test->Received();
+              },
+              static_cast<void *>(this), AITT_TYPE_MQTT, AITT_QOS_AT_MOST_ONCE, flags);
+        // Wait for the SUBACK
+        usleep(100000);
+
+        std::vector<char> payload(size, 'a');
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < count; i++)
+            aitt.Publish(testTopic, payload.data(), payload.size());
+        WaitReceived(count);
+        auto end = std::chrono::steady_clock::now();
+
+        aitt.Disconnect();
+        return std::chrono::duration<double, std::milli>(end - start).count();
+    }
+
+    // Returns the average time in microseconds from Publish() to the callback
+    double DeliveryLatency(int flags, int count)
+    {
+        AITT aitt(clientId + std::to_string(flags), LOCAL_IP, AittOption(true, false));
+        aitt.Connect();
+
+        received = 0;
+        std::vector<double> latencies;
+        aitt.Subscribe(
+              testTopic,
+              [&](aitt::MSG *handle, const void *msg, const size_t szmsg, void *cbdata) {
+                  auto now = std::chrono::steady_clock::now().time_since_epoch();
+                  std::chrono::steady_clock::duration::rep sent;
+                  memcpy(&sent, msg, sizeof(sent));
+                  auto elapsed = now - std::chrono::steady_clock::duration(sent);
+                  latencies.push_back(std::chrono::duration<double, std::micro>(elapsed).count());
+                  Received();
+              },
+              nullptr, AITT_TYPE_MQTT, AITT_QOS_AT_MOST_ONCE, flags);
+        usleep(100000);
+
+        for (int i = 0; i < count; i++) {
+            auto sent = std::chrono::steady_clock::now().time_since_epoch().count();
+            aitt.Publish(testTopic, &sent, sizeof(sent));
+            WaitReceived(i + 1);
+        }
+        aitt.Disconnect();
+
+        double sum = 0;
+        for (double latency : latencies)
+            sum += latency;
+        return sum / latencies.size();
+    }
+
+    // Returns the average time in microseconds of a PublishWithReplySync() round trip
+    double SyncCallLatency(bool multiplex_reply, int count)
+    {
+        AittOption option(true, false);
+        option.SetMultiplexReply(multiplex_reply);
+        AITT responder(clientId + "responder", LOCAL_IP, AittOption(true, false));
+        AITT requester(clientId + "requester", LOCAL_IP, option);
+        responder.Connect();
+        requester.Connect();
+
+        responder.Subscribe(
+              testTopic,
+              [&](aitt::MSG *handle, const void *msg, const size_t szmsg, void *cbdata) {
+                  responder.SendReply(handle, msg, szmsg, true);
+              },
+              nullptr, AITT_TYPE_MQTT, AITT_QOS_AT_MOST_ONCE, AITT_SUBSCRIBE_INLINE);
+        usleep(100000);
+
+        char request = 'a';
+        auto ignore_reply = [](aitt::MSG *handle, const void *msg, const size_t szmsg,
+                                  void *cbdata) {};
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < count; i++) {
+            int ret = requester.PublishWithReplySync(testTopic, &request, sizeof(request),
+                  AITT_TYPE_MQTT, AITT_QOS_AT_MOST_ONCE, false, ignore_reply, nullptr, "bench",
+                  5000);
+            EXPECT_EQ(ret, 0);
+        }
+        auto end = std::chrono::steady_clock::now();
+
+        requester.Disconnect();
+        responder.Disconnect();
+        return std::chrono::duration<double, std::micro>(end - start).count() / count;
+    }
+
+    // Returns the number of replies per second streamed back for a single request
+    double ReplyRate(int count, size_t size)
+    {
+        AITT responder(clientId + "responder", LOCAL_IP, AittOption(true, false));
+        AITT requester(clientId + "requester", LOCAL_IP, AittOption(true, false));
+        responder.Connect();
+        requester.Connect();
+
+        std::vector<char> payload(size, 'a');
+        responder.Subscribe(
+              testTopic,
+              [&](aitt::MSG *handle, const void *msg, const size_t szmsg, void *cbdata) {
+                  for (int i = 0; i < count; i++)
+                      responder.SendReply(handle, payload.data(), payload.size(), i == count - 1);
+              },
+              nullptr, AITT_TYPE_MQTT, AITT_QOS_AT_MOST_ONCE);
+        usleep(100000);
+
+        received = 0;
+        char request = 'a';
+        auto start = std::chrono::steady_clock::now();
+        requester.PublishWithReply(testTopic, &request, sizeof(request), AITT_TYPE_MQTT,
+              AITT_QOS_AT_MOST_ONCE, false,
+              [](aitt::MSG *handle, const void *msg, const size_t szmsg, void *cbdata) {
+                  BenchmarkManualTest *test = static_cast<BenchmarkManualTest *>(cbdata);
+                  test->Received();
+              },
+              static_cast<void *>(this), "bench");
+        WaitReceived(count);
+        auto end = std::chrono::steady_clock::now();
+
+        requester.Disconnect();
+        responder.Disconnect();
+        return count / std::chrono::duration<double>(end - start).count();
+    }
+
+    // Returns the number of QoS 1 messages acknowledged per second, over 'connections'
+    double PublishThroughput(int connections, int count)
+    {
+        const int topics = 16;
+        AittOption option(true, false);
+        option.SetMQConnections(connections);
+        AITT aitt(clientId + std::to_string(connections), LOCAL_IP, option);
+        aitt.Connect();
+
+        received = 0;
+        aitt.SetPublishAckCallback(
+              [](AITT &handle, const std::string &topic, int result, void *user_data) {
+                  BenchmarkManualTest *test = static_cast<BenchmarkManualTest *>(user_data);
+                  test->Received();
+              },
+              static_cast<void *>(this));
+
+        std::vector<char> payload(256, 'a');
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < count; i++) {
+            aitt.Publish(testTopic + std::to_string(i % topics), payload.data(), payload.size(),
+                  AITT_TYPE_MQTT, AITT_QOS_AT_LEAST_ONCE);
+        }
+        WaitReceived(count);
+        auto end = std::chrono::steady_clock::now();
+
+        aitt.Disconnect();
+        return count / std::chrono::duration<double>(end - start).count();
+    }
+
+    // Returns the average time in microseconds from AddIdle() on another thread to the callback
+    double IdleWakeupLatency(MainLoopHandler::Backend backend, int count)
+    {
+        MainLoopHandler loop(backend);
+        std::thread loop_thread([&]() { loop.Run(); });
+
+        received = 0;
+        double sum = 0;
+        for (int i = 0; i < count; i++) {
+            auto sent = std::chrono::steady_clock::now();
+            MainLoopHandler::AddIdle(
+                  &loop,
+                  [&, sent](MainLoopHandler::MainLoopResult result, int fd,
+                        MainLoopHandler::MainLoopData *data) {
+                      auto elapsed = std::chrono::steady_clock::now() - sent;
+                      sum += std::chrono::duration<double, std::micro>(elapsed).count();
+                      Received();
+                  },
+                  nullptr);
+            WaitReceived(i + 1);
+        }
+
+        while (loop.Quit() == false)
+            usleep(1000);
+        loop_thread.join();
+        return sum / count;
+    }
+
+    // Returns the number of watch callbacks per second, while another thread writes 'count' bytes
+    // one by one to the watched socket
+    double WatchEventRate(MainLoopHandler::Backend backend, int count)
+    {
+        int fds[2];
+        if (socketpair(AF_UNIX, SOCK_STREAM, 0, fds) != 0)
+            throw std::runtime_error("socketpair() Fail");
+
+        MainLoopHandler loop(backend);
+        int events = 0;
+        int read_bytes = 0;
+        loop.AddWatch(
+              fds[0],
+              [&](MainLoopHandler::MainLoopResult result, int fd,
+                    MainLoopHandler::MainLoopData *data) {
+                  char buf[4096];
+                  ssize_t ret = read(fd, buf, sizeof(buf));
+                  events++;
+                  if (0 < ret)
+                      read_bytes += ret;
+                  if (ret <= 0 || count <= read_bytes)
+                      loop.Quit();
+              },
+              nullptr);
+
+        auto start = std::chrono::steady_clock::now();
+        std::thread writer([&]() {
+            for (int i = 0; i < count; i++) {
+                if (write(fds[1], "a", 1) != 1)
+                    break;
+            }
+        });
+        loop.Run();
+        auto end = std::chrono::steady_clock::now();
+        writer.join();
+
+        loop.RemoveWatch(fds[0]);
+        close(fds[0]);
+        close(fds[1]);
+        EXPECT_EQ(read_bytes, count);
+        return events / std::chrono::duration<double>(end - start).count();
+    }
+
+    std::mutex received_lock;
+    std::condition_variable received_cond;
+    int received;
+};
+
+TEST_F(BenchmarkManualTest, ZeroCopy_Delivery)
+{
+    const int count = 200;
+    const size_t sizes[] = {1024, 64 * 1024, 1024 * 1024};
+
+    try {
+        for (size_t size : sizes) {
+            double copy_ms = ReceiveThroughput(AITT_SUBSCRIBE_DEFAULT, count, size);
+            double zero_copy_ms = ReceiveThroughput(AITT_SUBSCRIBE_ZERO_COPY, count, size);
+            INFO("%d messages of %zu bytes: copy %.2f ms, zero-copy %.2f ms", count, size, copy_ms,
+                  zero_copy_ms);
+        }
+    } catch (std::exception &e) {
+        FAIL() << "Unexpected exception: " << e.what();
+    }
+}
+
+TEST_F(BenchmarkManualTest, Inline_Delivery_Latency)
+{
+    const int count = 1000;
+
+    try {
+        double worker_us = DeliveryLatency(AITT_SUBSCRIBE_DEFAULT, count);
+        double inline_us = DeliveryLatency(AITT_SUBSCRIBE_INLINE, count);
+        INFO("average latency of %d messages: worker thread %.2f us, inline %.2f us", count,
+              worker_us, inline_us);
+    } catch (std::exception &e) {
+        FAIL() << "Unexpected exception: " << e.what();
+    }
+}
+
+TEST_F(BenchmarkManualTest, Sync_Call_Latency)
+{
+    const int count = 1000;
+
+    try {
+        double per_request_us = SyncCallLatency(false, count);
+        double multiplex_us = SyncCallLatency(true, count);
+        INFO("average PublishWithReplySync() of %d calls: reply topic per request %.2f us, "
+             "multiplexed reply topic %.2f us",
+              count, per_request_us, multiplex_us);
+    } catch (std::exception &e) {
+        FAIL() << "Unexpected exception: " << e.what();
+    }
+}
+
+TEST_F(BenchmarkManualTest, Reply_Stream_Rate)
+{
+    const int count = 10000;
+    const size_t sizes[] = {16, 1024};
+
+    try {
+        for (size_t size : sizes) {
+            double rate = ReplyRate(count, size);
+            INFO("%d replies of %zu bytes: %.0f replies/sec", count, size, rate);
+        }
+    } catch (std::exception &e) {
+        FAIL() << "Unexpected exception: " << e.what();
+    }
+}
+
+TEST_F(BenchmarkManualTest, TopicFilter_Match)
+{
+    const int count = 1000000;
+    const std::string filters[] = {"aitt/test/topic", "aitt/+/topic", "aitt/#"};
+    const std::string topic = "aitt/test/topic";
+
+    for (const std::string &filter : filters) {
+        int matched = 0;
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < count; i++)
+            matched += aitt::AittUtil::CompareTopic(filter, topic);
+        auto end = std::chrono::steady_clock::now();
+        double compare_ns = std::chrono::duration<double, std::nano>(end - start).count() / count;
+
+        aitt::AittUtil::TopicFilter topic_filter(filter);
+        start = std::chrono::steady_clock::now();
+        for (int i = 0; i < count; i++)
+            matched += topic_filter.Match(topic);
+        end = std::chrono::steady_clock::now();
+        double filter_ns = std::chrono::duration<double, std::nano>(end - start).count() / count;
+
+        EXPECT_EQ(matched, count * 2);
+        INFO("%s: CompareTopic() %.1f ns, TopicFilter::Match() %.1f ns", filter.c_str(),
+              compare_ns, filter_ns);
+    }
+}
+
+TEST_F(BenchmarkManualTest, MQ_Connections_Publish_Throughput)
+{
+    const int count = 20000;
+    const int connections[] = {1, 2, 4};
+
+    try {
+        for (int connection : connections) {
+            double rate = PublishThroughput(connection, count);
+            INFO("%d QoS 1 messages over %d connection(s): %.0f messages/sec", count, connection,
+                  rate);
+        }
+    } catch (std::exception &e) {
+        FAIL() << "Unexpected exception: " << e.what();
+    }
+}
+
+TEST_F(BenchmarkManualTest, MainLoop_Backends)
+{
+    const int count = 100000;
+    const MainLoopHandler::Backend backends[] = {MainLoopHandler::GLIB_BACKEND,
+          MainLoopHandler::POSIX_BACKEND};
+    const char *names[] = {"GLib", "epoll"};
+
+    try {
+        for (int i = 0; i < 2; i++) {
+            double latency_us = IdleWakeupLatency(backends[i], count / 10);
+            double rate = WatchEventRate(backends[i], count);
+            INFO("%s: AddIdle() wakeup %.2f us, %.0f watch events/sec", names[i], latency_us,
+                  rate);
+        }
+    } catch (std::exception &e) {
+        FAIL() << "Unexpected exception: " << e.what();
+    }
+}
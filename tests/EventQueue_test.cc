@@ -0,0 +1,196 @@
+/*
+ * Copyright (c) 2022 Samsung Electronics Co., Ltd All Rights Reserved
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "EventQueue.h"
+
+#include <gtest/gtest.h>
+#include <poll.h>
+
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "RingBuffer.h"
+
+using namespace aitt;
+
+using Item = std::pair<int, int>;  // producer, sequence
+
+static bool IsReadable(int fd)
+{
+    struct pollfd pfd = {fd, POLLIN, 0};
+    return poll(&pfd, 1, 0) == 1;
+}
+
+TEST(RingBufferTest, Push_Pop_P_Anytime)
+{
+    RingBuffer<int> ring(3);
+    ASSERT_EQ(ring.Capacity(), 4u);
+
+    for (int i = 0; i < 4; i++)
+        EXPECT_TRUE(ring.Push(int(i)));
+    EXPECT_FALSE(ring.Push(4));
+
+    int value;
+    for (int i = 0; i < 4; i++) {
+        ASSERT_TRUE(ring.Pop(value));
+        EXPECT_EQ(value, i);
+    }
+    EXPECT_FALSE(ring.Pop(value));
+}
+
+TEST(EventQueueTest, Single_Wakeup_P_Anytime)
+{
+    EventQueue<int> queue(16);
+    EXPECT_FALSE(IsReadable(queue.GetHandle()));
+
+    for (int i = 0; i < 10; i++)
+        queue.Push(int(i));
+    EXPECT_TRUE(IsReadable(queue.GetHandle()));
+
+    std::vector<int> result;
+    size_t count = queue.Drain([&](int &value) { result.push_back(value); }, 100);
+    EXPECT_EQ(count, 10u);
+    EXPECT_EQ(result, std::vector<int>({0, 1, 2, 3, 4, 5, 6, 7, 8, 9}));
+    EXPECT_FALSE(IsReadable(queue.GetHandle()));
+}
+
+TEST(EventQueueTest, Overflow_Order_P_Anytime)
+{
+    EventQueue<int> queue(4);
+    for (int i = 0; i < 20; i++)
+        queue.Push(int(i));
+
+    std::vector<int> result;
+    queue.Drain([&](int &value) { result.push_back(value); }, 2);
+    EXPECT_TRUE(IsReadable(queue.GetHandle()));
+
+    // pushed while the overflow list is not empty
+    queue.Push(20);
+    while (IsReadable(queue.GetHandle()))
+        queue.Drain([&](int &value) { result.push_back(value); }, 2);
+
+    ASSERT_EQ(result.size(), 21u);
+    for (int i = 0; i < 21; i++)
+        EXPECT_EQ(result[i], i);
+}
+
+TEST(EventQueueTest, Multi_Producer_P_Anytime)
+{
+    const int producers = 4;
+    const int items = 20000;
+    EventQueue<Item> queue(64);
+
+    std::vector<std::thread> threads;
+    for (int p = 0; p < producers; p++) {
+        threads.push_back(std::thread([&queue, p, items]() {
+            for (int i = 0; i < items; i++)
+                queue.Push(Item(p, i));
+        }));
+    }
+
+    std::vector<int> next(producers, 0);
+    int received = 0;
+    bool in_order = true;
+    while (received < producers * items) {
+        struct pollfd pfd = {queue.GetHandle(), POLLIN, 0};
+        ASSERT_EQ(poll(&pfd, 1, 1000), 1);
+        received += queue.Drain(
+              [&](Item &item) {
+                  if (next[item.first] != item.second)
+                      in_order = false;
+                  next[item.first] = item.second + 1;
+              },
+              256);
+    }
+
+    for (auto &thread : threads)
+        thread.join();
+
+    EXPECT_TRUE(in_order);
+    for (int p = 0; p < producers; p++)
+        EXPECT_EQ(next[p], items);
+}
+
+TEST(EventQueueTest, Pop_Steps_P_Anytime)
+{
+    EventQueue<int> high(16);
+    EventQueue<int> normal(16);
+    for (int i = 0; i < 4; i++)
+        normal.Push(int(i));
+    high.Push(100);
+
+    // One consumer serving both queues, as DeliverMessages() does
+    std::vector<int> result;
+    auto collect = [&](int &value) { result.push_back(value); };
+    high.Acknowledge();
+    normal.Acknowledge();
+    EXPECT_FALSE(IsReadable(high.GetHandle()));
+    EXPECT_FALSE(IsReadable(normal.GetHandle()));
+
+    EXPECT_EQ(high.Pop(collect, 2), 1u);
+    EXPECT_EQ(normal.Pop(collect, 1), 1u);
+    high.Push(101);
+    EXPECT_TRUE(IsReadable(high.GetHandle()));
+    EXPECT_EQ(high.Pop(collect, 2), 1u);
+    EXPECT_EQ(normal.Pop(collect, 1), 1u);
+    EXPECT_EQ(result, std::vector<int>({100, 0, 101, 1}));
+
+    normal.Wakeup();
+    EXPECT_TRUE(IsReadable(normal.GetHandle()));
+    EXPECT_EQ(normal.Drain(collect, 100), 2u);
+    EXPECT_FALSE(IsReadable(normal.GetHandle()));
+}
+
+TEST(EventQueueTest, Overflow_Max_Items_P_Anytime)
+{
+    EventQueue<int> high(4);
+    EventQueue<int> normal(4);
+    for (int i = 0; i < 20; i++)
+        high.Push(int(i));
+    normal.Push(100);
+
+    // The overflow list is delivered in steps of max_items too
+    std::vector<int> result;
+    auto collect = [&](int &value) { result.push_back(value); };
+    high.Acknowledge();
+    normal.Acknowledge();
+    for (int i = 0; i < 3; i++)
+        EXPECT_EQ(high.Pop(collect, 2), 2u);
+    EXPECT_EQ(normal.Pop(collect, 1), 1u);
+    EXPECT_EQ(result, std::vector<int>({0, 1, 2, 3, 4, 5, 100}));
+
+    // Pushed after the overflow list was taken, so delivered after it
+    high.Push(20);
+    result.clear();
+    for (int i = 0; i < 8; i++)
+        high.Pop(collect, 2);
+    ASSERT_EQ(result.size(), 15u);
+    for (int i = 0; i < 15; i++)
+        EXPECT_EQ(result[i], i + 6);
+}
+
+TEST(EventQueueTest, Teardown_Releases_Items_P_Anytime)
+{
+    std::shared_ptr<int> item = std::make_shared<int>(0);
+    {
+        // Two items in the ring and one in the overflow list
+        EventQueue<std::shared_ptr<int>> queue(2);
+        for (int i = 0; i < 3; i++)
+            queue.Push(std::shared_ptr<int>(item));
+        EXPECT_EQ(item.use_count(), 4);
+    }
+    EXPECT_EQ(item.use_count(), 1);
+}
@@ -22,6 +22,8 @@
 
 #include <cstdlib>
 #include <thread>
+#include <type_traits>
+#include <vector>
 
 #include "aitt_internal.h"
 
@@ -76,15 +78,29 @@ class MainLoopTest : public testing::Test {
 
 using aitt::MainLoopHandler;
 
-TEST_F(MainLoopTest, Normal_Anytime)
+// Runs the tests on each backend
+template <typename Backend>
+class MainLoopBackendTest : public MainLoopTest {};
+
+template <MainLoopHandler::Backend backend>
+using MainLoopBackend = std::integral_constant<MainLoopHandler::Backend, backend>;
+using MainLoopBackends = testing::Types<MainLoopBackend<MainLoopHandler::GLIB_BACKEND>,
+      MainLoopBackend<MainLoopHandler::POSIX_BACKEND>>;
+#ifdef TYPED_TEST_SUITE
+TYPED_TEST_SUITE(MainLoopBackendTest, MainLoopBackends);
+#else
+TYPED_TEST_CASE(MainLoopBackendTest, MainLoopBackends);
+#endif
+
+TYPED_TEST(MainLoopBackendTest, Normal_Anytime)
 {
-    MainLoopHandler handler;
+    MainLoopHandler handler(TypeParam::value);
     bool ret = false;
 
     handler.AddWatch(
-          server_fd,
+          this->server_fd,
           [&](MainLoopHandler::MainLoopResult result, int fd, MainLoopHandler::MainLoopData *data) {
-              int client_fd = accept(server_fd, 0, 0);
+              int client_fd = accept(this->server_fd, 0, 0);
               EXPECT_NE(client_fd, -1);
               handler.AddWatch(
                     client_fd,
@@ -105,15 +121,15 @@ TEST_F(MainLoopTest, Normal_Anytime)
     EXPECT_TRUE(ret);
 }
 
-TEST_F(MainLoopTest, HANGUP_Anytime)
+TYPED_TEST(MainLoopBackendTest, HANGUP_Anytime)
 {
-    MainLoopHandler handler;
+    MainLoopHandler handler(TypeParam::value);
     bool ret = false;
 
     handler.AddWatch(
-          server_fd,
+          this->server_fd,
           [&](MainLoopHandler::MainLoopResult result, int fd, MainLoopHandler::MainLoopData *data) {
-              int client_fd = accept(server_fd, 0, 0);
+              int client_fd = accept(this->server_fd, 0, 0);
               EXPECT_NE(client_fd, -1);
               handler.AddWatch(
                     client_fd,
@@ -139,31 +155,31 @@ TEST_F(MainLoopTest, HANGUP_Anytime)
     EXPECT_TRUE(ret);
 }
 
-TEST_F(MainLoopTest, removeWatch_Anytime)
+TYPED_TEST(MainLoopBackendTest, removeWatch_Anytime)
 {
-    MainLoopHandler handler;
+    MainLoopHandler handler(TypeParam::value);
     MainLoopHandler::MainLoopData test_data;
 
     handler.AddWatch(
-          server_fd,
+          this->server_fd,
           [&](MainLoopHandler::MainLoopResult result, int fd, MainLoopHandler::MainLoopData *data) {
               FAIL() << "It's removed";
           },
           &test_data);
-    MainLoopHandler::MainLoopData *check_data = handler.RemoveWatch(server_fd);
+    MainLoopHandler::MainLoopData *check_data = handler.RemoveWatch(this->server_fd);
 
     EXPECT_TRUE(&test_data == check_data);
 }
 
-TEST_F(MainLoopTest, UserData_Anytime)
+TYPED_TEST(MainLoopBackendTest, UserData_Anytime)
 {
-    MainLoopHandler handler;
+    MainLoopHandler handler(TypeParam::value);
     bool ret = false;
 
     MainLoopHandler::MainLoopData test_data;
 
     handler.AddWatch(
-          server_fd,
+          this->server_fd,
           [&](MainLoopHandler::MainLoopResult result, int fd, MainLoopHandler::MainLoopData *data) {
               EXPECT_EQ(data, &test_data);
               handler.Quit();
@@ -176,10 +192,10 @@ TEST_F(MainLoopTest, UserData_Anytime)
     EXPECT_TRUE(ret);
 }
 
-TEST_F(MainLoopTest, AddIdle_Anytime)
+TYPED_TEST(MainLoopBackendTest, AddIdle_Anytime)
 {
     bool ret = false;
-    MainLoopHandler handler;
+    MainLoopHandler handler(TypeParam::value);
     MainLoopHandler::MainLoopData test_data;
 
     handler.AddIdle(
@@ -196,11 +212,11 @@ TEST_F(MainLoopTest, AddIdle_Anytime)
     EXPECT_TRUE(ret);
 }
 
-TEST_F(MainLoopTest, AddTimeout_Anytime)
+TYPED_TEST(MainLoopBackendTest, AddTimeout_Anytime)
 {
     bool ret = false;
     int interval = 1000;
-    MainLoopHandler handler;
+    MainLoopHandler handler(TypeParam::value);
     struct timespec ts_start, ts_end;
     MainLoopHandler::MainLoopData test_data;
 
@@ -223,3 +239,110 @@ TEST_F(MainLoopTest, AddTimeout_Anytime)
 
     EXPECT_TRUE(ret);
 }
+
+TYPED_TEST(MainLoopBackendTest, RemoveTimeout_Anytime)
+{
+    bool ret = false;
+    MainLoopHandler handler(TypeParam::value);
+
+    unsigned int id = handler.AddTimeout(
+          10,
+          [&](MainLoopHandler::MainLoopResult result, int fd, MainLoopHandler::MainLoopData *data) {
+              FAIL() << "It's removed";
+          },
+          nullptr);
+    handler.AddTimeout(
+          100,
+          [&](MainLoopHandler::MainLoopResult result, int fd, MainLoopHandler::MainLoopData *data) {
+              handler.Quit();
+              ret = true;
+          },
+          nullptr);
+    handler.RemoveTimeout(id);
+
+    handler.Run();
+
+    EXPECT_TRUE(ret);
+}
+
+TYPED_TEST(MainLoopBackendTest, AddTimer_Anytime)
+{
+    std::vector<int> order;
+    MainLoopHandler handler(TypeParam::value);
+    MainLoopHandler::MainLoopData test_data;
+    auto timer_cb = [&](int index) {
+        return [&, index](MainLoopHandler::MainLoopResult result, int fd,
+                     MainLoopHandler::MainLoopData *data) {
+            EXPECT_EQ(fd, -1);
+            EXPECT_EQ(data, &test_data);
+            order.push_back(index);
+            if (index == 0)
+                handler.Quit();
+        };
+    };
+
+    MainLoopHandler::TimerID rearmed = handler.AddTimer(20, timer_cb(0), &test_data);
+    MainLoopHandler::TimerID removed = handler.AddTimer(30, timer_cb(1), &test_data);
+    MainLoopHandler::TimerID expired = handler.AddTimer(40, timer_cb(2), &test_data);
+    EXPECT_TRUE(handler.RearmTimer(rearmed, 200));
+    handler.RemoveTimer(removed);
+    EXPECT_FALSE(handler.RearmTimer(removed, 10));
+
+    handler.Run();
+
+    EXPECT_EQ(order, std::vector<int>({2, 0}));
+    EXPECT_FALSE(handler.RearmTimer(expired, 10));
+}
+
+TYPED_TEST(MainLoopBackendTest, AddIdle_Thread_Anytime)
+{
+    const int count = 1000;
+    int called = 0;
+    MainLoopHandler handler(TypeParam::value);
+
+    std::thread idler([&]() {
+        for (int i = 0; i < count; i++) {
+            MainLoopHandler::AddIdle(
+                  &handler,
+                  [&](MainLoopHandler::MainLoopResult result, int fd,
+                        MainLoopHandler::MainLoopData *data) {
+                      if (++called == count)
+                          handler.Quit();
+                  },
+                  nullptr);
+        }
+    });
+    handler.Run();
+    idler.join();
+
+    EXPECT_EQ(called, count);
+}
+
+TYPED_TEST(MainLoopBackendTest, AddIdle_Nested_Anytime)
+{
+    std::vector<int> order;
+    MainLoopHandler handler(TypeParam::value);
+
+    for (int i = 0; i < 3; i++) {
+        handler.AddIdle(
+              [&, i](MainLoopHandler::MainLoopResult result, int fd,
+                    MainLoopHandler::MainLoopData *data) {
+                  order.push_back(i);
+                  if (i != 2)
+                      return;
+
+                  // Added while the queue is being dispatched
+                  handler.AddIdle(
+                        [&](MainLoopHandler::MainLoopResult result, int fd,
+                              MainLoopHandler::MainLoopData *data) {
+                            order.push_back(3);
+                            handler.Quit();
+                        },
+                        nullptr);
+              },
+              nullptr);
+    }
+    handler.Run();
+
+    EXPECT_EQ(order, std::vector<int>({0, 1, 2, 3}));
+}
@@ -15,10 +15,12 @@
  */
 #include <gmock/gmock.h>
 #include <gtest/gtest.h>
+#include <mqtt_protocol.h>
 
 #include <condition_variable>
 #include <mutex>
 
+#include "AittException.h"
 #include "AittTypes.h"
 #include "MQMockTest.h"
 #include "MQTTMock.h"
@@ -73,7 +75,8 @@ TEST_F(MQMockTest, Publish_P_Anytime)
           .WillOnce(Return(MOSQ_ERR_SUCCESS));
     EXPECT_CALL(GetMock(), mosquitto_message_v5_callback_set(TEST_HANDLE, testing::_)).Times(1);
     EXPECT_CALL(GetMock(), mosquitto_loop_start(TEST_HANDLE)).WillOnce(Return(MOSQ_ERR_SUCCESS));
-    EXPECT_CALL(GetMock(), mosquitto_connect(TEST_HANDLE, testing::StrEq(TEST_HOST), TEST_PORT, 60))
+    EXPECT_CALL(GetMock(),
+          mosquitto_connect_async(TEST_HANDLE, testing::StrEq(TEST_HOST), TEST_PORT, 60))
           .WillOnce(Return(MOSQ_ERR_SUCCESS));
     EXPECT_CALL(GetMock(), mosquitto_publish(TEST_HANDLE, testing::_, testing::StrEq(TEST_TOPIC),
                                  sizeof(TEST_PAYLOAD), TEST_PAYLOAD, AITT_QOS_AT_MOST_ONCE, false))
@@ -90,6 +93,112 @@ TEST_F(MQMockTest, Publish_P_Anytime)
     }
 }
 
+TEST_F(MQMockTest, Publish_Would_Block_P_Anytime)
+{
+    void *obj = nullptr;
+    void (*publish_cb)(struct mosquitto *, void *, int, int, const mosquitto_property *) = nullptr;
+
+    EXPECT_CALL(GetMock(), mosquitto_lib_init()).WillOnce(Return(MOSQ_ERR_SUCCESS));
+    EXPECT_CALL(GetMock(), mosquitto_new(testing::StrEq(TEST_CLIENT_ID), true, testing::_))
+          .WillOnce(testing::DoAll(testing::SaveArg<2>(&obj), Return(TEST_HANDLE)));
+    EXPECT_CALL(GetMock(), mosquitto_publish_v5_callback_set(TEST_HANDLE, testing::_))
+          .WillOnce(testing::SaveArg<1>(&publish_cb));
+    EXPECT_CALL(GetMock(),
+          mosquitto_int_option(TEST_HANDLE, MOSQ_OPT_PROTOCOL_VERSION, MQTT_PROTOCOL_V5))
+          .WillOnce(Return(MOSQ_ERR_SUCCESS));
+    EXPECT_CALL(GetMock(), mosquitto_int_option(TEST_HANDLE, MOSQ_OPT_SEND_MAXIMUM, 1))
+          .WillOnce(Return(MOSQ_ERR_SUCCESS));
+    EXPECT_CALL(GetMock(), mosquitto_loop_start(TEST_HANDLE)).WillOnce(Return(MOSQ_ERR_SUCCESS));
+    EXPECT_CALL(GetMock(),
+          mosquitto_connect_async(TEST_HANDLE, testing::StrEq(TEST_HOST), TEST_PORT, 60))
+          .WillOnce(Return(MOSQ_ERR_SUCCESS));
+    EXPECT_CALL(GetMock(), mosquitto_publish(TEST_HANDLE, testing::_, testing::StrEq(TEST_TOPIC),
+                                 sizeof(TEST_PAYLOAD), testing::_, AITT_QOS_AT_LEAST_ONCE, false))
+          .Times(2)
+          .WillOnce(testing::DoAll(testing::SetArgPointee<1>(1), Return(MOSQ_ERR_SUCCESS)))
+          .WillOnce(testing::DoAll(testing::SetArgPointee<1>(2), Return(MOSQ_ERR_SUCCESS)));
+    EXPECT_CALL(GetMock(), mosquitto_destroy(TEST_HANDLE)).Times(1);
+    EXPECT_CALL(GetMock(), mosquitto_lib_cleanup()).WillOnce(Return(MOSQ_ERR_SUCCESS));
+
+    try {
+        aitt::MosquittoMQ mq(TEST_CLIENT_ID, true);
+        mq.SetPublishLimits(1, 1);
+        std::string acked;
+        mq.SetPublishAckCallback([&](const std::string &topic, int result) {
+            EXPECT_EQ(result, 0);
+            acked = topic;
+        });
+        mq.Connect(TEST_HOST, TEST_PORT, "", "");
+        ASSERT_NE(publish_cb, nullptr);
+
+        mq.Publish(TEST_TOPIC, TEST_PAYLOAD, sizeof(TEST_PAYLOAD), AITT_QOS_AT_LEAST_ONCE);
+        try {
+            mq.Publish(TEST_TOPIC, TEST_PAYLOAD, sizeof(TEST_PAYLOAD), AITT_QOS_AT_LEAST_ONCE);
+            FAIL() << "Should not be queued";
+        } catch (aitt::AittException &e) {
+            EXPECT_EQ(e.getErrCode(), aitt::AittException::WOULD_BLOCK_ERR);
+        }
+
+        publish_cb(TEST_HANDLE, obj, 1, 0, nullptr);
+        EXPECT_EQ(acked, TEST_TOPIC);
+        mq.Publish(TEST_TOPIC, TEST_PAYLOAD, sizeof(TEST_PAYLOAD), AITT_QOS_AT_LEAST_ONCE);
+    } catch (std::exception &e) {
+        FAIL() << "Unexpected exception: " << e.what();
+    }
+}
+
+TEST_F(MQMockTest, Publish_Early_Ack_P_Anytime)
+{
+    void *obj = nullptr;
+    void (*publish_cb)(struct mosquitto *, void *, int, int, const mosquitto_property *) = nullptr;
+
+    EXPECT_CALL(GetMock(), mosquitto_lib_init()).WillOnce(Return(MOSQ_ERR_SUCCESS));
+    EXPECT_CALL(GetMock(), mosquitto_new(testing::StrEq(TEST_CLIENT_ID), true, testing::_))
+          .WillOnce(testing::DoAll(testing::SaveArg<2>(&obj), Return(TEST_HANDLE)));
+    EXPECT_CALL(GetMock(), mosquitto_publish_v5_callback_set(TEST_HANDLE, testing::_))
+          .WillOnce(testing::SaveArg<1>(&publish_cb));
+    EXPECT_CALL(GetMock(),
+          mosquitto_int_option(TEST_HANDLE, MOSQ_OPT_PROTOCOL_VERSION, MQTT_PROTOCOL_V5))
+          .WillOnce(Return(MOSQ_ERR_SUCCESS));
+    EXPECT_CALL(GetMock(), mosquitto_loop_start(TEST_HANDLE)).WillOnce(Return(MOSQ_ERR_SUCCESS));
+    EXPECT_CALL(GetMock(),
+          mosquitto_connect_async(TEST_HANDLE, testing::StrEq(TEST_HOST), TEST_PORT, 60))
+          .WillOnce(Return(MOSQ_ERR_SUCCESS));
+    // The broker acknowledges the message before mosquitto_publish() returns
+    EXPECT_CALL(GetMock(), mosquitto_publish(TEST_HANDLE, testing::_, testing::StrEq(TEST_TOPIC),
+                                 sizeof(TEST_PAYLOAD), testing::_, AITT_QOS_AT_LEAST_ONCE, false))
+          .Times(2)
+          .WillRepeatedly(testing::Invoke([&](struct mosquitto *mosq, int *mid, const char *topic,
+                                                int payloadlen, const void *payload, int qos,
+                                                bool retain) {
+              *mid = 1;
+              publish_cb(TEST_HANDLE, obj, 1, 0, nullptr);
+              return MOSQ_ERR_SUCCESS;
+          }));
+    EXPECT_CALL(GetMock(), mosquitto_destroy(TEST_HANDLE)).Times(1);
+    EXPECT_CALL(GetMock(), mosquitto_lib_cleanup()).WillOnce(Return(MOSQ_ERR_SUCCESS));
+
+    try {
+        aitt::MosquittoMQ mq(TEST_CLIENT_ID, true);
+        mq.SetPublishLimits(0, 1);
+        int acked = 0;
+        mq.SetPublishAckCallback([&](const std::string &topic, int result) {
+            EXPECT_EQ(topic, TEST_TOPIC);
+            EXPECT_EQ(result, 0);
+            acked++;
+        });
+        mq.Connect(TEST_HOST, TEST_PORT, "", "");
+        ASSERT_NE(publish_cb, nullptr);
+
+        // Within the limit of 1, since the first one is not pending anymore
+        mq.Publish(TEST_TOPIC, TEST_PAYLOAD, sizeof(TEST_PAYLOAD), AITT_QOS_AT_LEAST_ONCE);
+        mq.Publish(TEST_TOPIC, TEST_PAYLOAD, sizeof(TEST_PAYLOAD), AITT_QOS_AT_LEAST_ONCE);
+        EXPECT_EQ(acked, 2);
+    } catch (std::exception &e) {
+        FAIL() << "Unexpected exception: " << e.what();
+    }
+}
+
 TEST_F(MQMockTest, Subscribe_P_Anytime)
 {
     EXPECT_CALL(GetMock(), mosquitto_lib_init()).WillOnce(Return(MOSQ_ERR_SUCCESS));
@@ -97,7 +206,8 @@ TEST_F(MQMockTest, Subscribe_P_Anytime)
           .WillOnce(Return(TEST_HANDLE));
     EXPECT_CALL(GetMock(), mosquitto_message_v5_callback_set(TEST_HANDLE, testing::_)).Times(1);
     EXPECT_CALL(GetMock(), mosquitto_loop_start(TEST_HANDLE)).WillOnce(Return(MOSQ_ERR_SUCCESS));
-    EXPECT_CALL(GetMock(), mosquitto_connect(TEST_HANDLE, testing::StrEq(TEST_HOST), TEST_PORT, 60))
+    EXPECT_CALL(GetMock(),
+          mosquitto_connect_async(TEST_HANDLE, testing::StrEq(TEST_HOST), TEST_PORT, 60))
           .WillOnce(Return(MOSQ_ERR_SUCCESS));
     EXPECT_CALL(GetMock(), mosquitto_subscribe(TEST_HANDLE, testing::_, testing::StrEq(TEST_TOPIC),
                                  AITT_QOS_AT_MOST_ONCE))
@@ -125,7 +235,8 @@ TEST_F(MQMockTest, Unsubscribe_P_Anytime)
           .WillOnce(Return(TEST_HANDLE));
     EXPECT_CALL(GetMock(), mosquitto_message_v5_callback_set(TEST_HANDLE, testing::_)).Times(1);
     EXPECT_CALL(GetMock(), mosquitto_loop_start(TEST_HANDLE)).WillOnce(Return(MOSQ_ERR_SUCCESS));
-    EXPECT_CALL(GetMock(), mosquitto_connect(TEST_HANDLE, testing::StrEq(TEST_HOST), TEST_PORT, 60))
+    EXPECT_CALL(GetMock(),
+          mosquitto_connect_async(TEST_HANDLE, testing::StrEq(TEST_HOST), TEST_PORT, 60))
           .WillOnce(Return(MOSQ_ERR_SUCCESS));
     EXPECT_CALL(GetMock(),
           mosquitto_subscribe(TEST_HANDLE, testing::_, testing::StrEq(TEST_TOPIC), 0))
@@ -150,6 +261,199 @@ TEST_F(MQMockTest, Unsubscribe_P_Anytime)
     }
 }
 
+TEST_F(MQMockTest, Subscribe_Shared_Filter_P_Anytime)
+{
+    testing::InSequence sequence;
+    EXPECT_CALL(GetMock(), mosquitto_lib_init()).WillOnce(Return(MOSQ_ERR_SUCCESS));
+    EXPECT_CALL(GetMock(), mosquitto_new(testing::StrEq(TEST_CLIENT_ID), true, testing::_))
+          .WillOnce(Return(TEST_HANDLE));
+    EXPECT_CALL(GetMock(), mosquitto_loop_start(TEST_HANDLE)).WillOnce(Return(MOSQ_ERR_SUCCESS));
+    EXPECT_CALL(GetMock(),
+          mosquitto_connect_async(TEST_HANDLE, testing::StrEq(TEST_HOST), TEST_PORT, 60))
+          .WillOnce(Return(MOSQ_ERR_SUCCESS));
+    // The second subscriber shares the filter, the third one raises the QoS, and unsubscribing
+    // the third one lowers it again. The filter is unsubscribed with the last subscriber.
+    EXPECT_CALL(GetMock(),
+          mosquitto_subscribe(TEST_HANDLE, testing::_, testing::StrEq(TEST_TOPIC), 0))
+          .WillOnce(Return(MOSQ_ERR_SUCCESS));
+    EXPECT_CALL(GetMock(),
+          mosquitto_subscribe(TEST_HANDLE, testing::_, testing::StrEq(TEST_TOPIC), 1))
+          .WillOnce(Return(MOSQ_ERR_SUCCESS));
+    EXPECT_CALL(GetMock(),
+          mosquitto_subscribe(TEST_HANDLE, testing::_, testing::StrEq(TEST_TOPIC), 0))
+          .WillOnce(Return(MOSQ_ERR_SUCCESS));
+    EXPECT_CALL(GetMock(),
+          mosquitto_unsubscribe(TEST_HANDLE, testing::_, testing::StrEq(TEST_TOPIC)))
+          .WillOnce(Return(MOSQ_ERR_SUCCESS));
+    EXPECT_CALL(GetMock(), mosquitto_destroy(TEST_HANDLE)).Times(1);
+    EXPECT_CALL(GetMock(), mosquitto_lib_cleanup()).WillOnce(Return(MOSQ_ERR_SUCCESS));
+
+    try {
+        aitt::MosquittoMQ mq(TEST_CLIENT_ID, true);
+        mq.Connect(TEST_HOST, TEST_PORT, "", "");
+        auto cb = [](aitt::MSG *info, const std::string &topic, const void *msg,
+                        const int szmsg, const void *cbdata) -> void {};
+        void *first = mq.Subscribe(TEST_TOPIC, cb, nullptr, AITT_QOS_AT_MOST_ONCE);
+        void *second = mq.Subscribe(TEST_TOPIC, cb, nullptr, AITT_QOS_AT_MOST_ONCE);
+        void *third = mq.Subscribe(TEST_TOPIC, cb, nullptr, AITT_QOS_AT_LEAST_ONCE);
+        mq.Unsubscribe(first);
+        mq.Unsubscribe(third);
+        mq.Unsubscribe(second);
+    } catch (std::exception &e) {
+        FAIL() << "Unexpected exception: " << e.what();
+    }
+}
+
+TEST_F(MQMockTest, Subscribe_Subscription_ID_P_Anytime)
+{
+    void *obj = nullptr;
+    void (*connect_cb)(struct mosquitto *, void *, int, int, const mosquitto_property *) = nullptr;
+    void (*message_cb)(struct mosquitto *, void *, const struct mosquitto_message *,
+          const mosquitto_property *) = nullptr;
+
+    EXPECT_CALL(GetMock(), mosquitto_lib_init()).WillOnce(Return(MOSQ_ERR_SUCCESS));
+    EXPECT_CALL(GetMock(), mosquitto_new(testing::StrEq(TEST_CLIENT_ID), true, testing::_))
+          .WillOnce(testing::DoAll(testing::SaveArg<2>(&obj), Return(TEST_HANDLE)));
+    EXPECT_CALL(GetMock(), mosquitto_message_v5_callback_set(TEST_HANDLE, testing::_))
+          .WillOnce(testing::SaveArg<1>(&message_cb));
+    EXPECT_CALL(GetMock(), mosquitto_connect_v5_callback_set(TEST_HANDLE, testing::_))
+          .WillOnce(testing::SaveArg<1>(&connect_cb));
+    EXPECT_CALL(GetMock(), mosquitto_loop_start(TEST_HANDLE)).WillOnce(Return(MOSQ_ERR_SUCCESS));
+    EXPECT_CALL(GetMock(),
+          mosquitto_connect_async(TEST_HANDLE, testing::StrEq(TEST_HOST), TEST_PORT, 60))
+          .WillOnce(Return(MOSQ_ERR_SUCCESS));
+    EXPECT_CALL(GetMock(), mosquitto_subscribe_v5(TEST_HANDLE, testing::_,
+                                 testing::StrEq(TEST_TOPIC), 0, 0, testing::NotNull()))
+          .WillOnce(Return(MOSQ_ERR_SUCCESS));
+    EXPECT_CALL(GetMock(), mosquitto_subscribe_v5(TEST_HANDLE, testing::_,
+                                 testing::StrEq("Test/+"), 0, 0, testing::NotNull()))
+          .WillOnce(Return(MOSQ_ERR_SUCCESS));
+    EXPECT_CALL(GetMock(), mosquitto_destroy(TEST_HANDLE)).Times(1);
+    EXPECT_CALL(GetMock(), mosquitto_lib_cleanup()).WillOnce(Return(MOSQ_ERR_SUCCESS));
+
+    try {
+        aitt::MosquittoMQ mq(TEST_CLIENT_ID, true);
+        mq.Connect(TEST_HOST, TEST_PORT, "", "");
+        ASSERT_NE(connect_cb, nullptr);
+        ASSERT_NE(message_cb, nullptr);
+        connect_cb(TEST_HANDLE, obj, 0, 0, nullptr);
+
+        int exact = 0;
+        int wildcard = 0;
+        mq.Subscribe(
+              TEST_TOPIC,
+              [&](aitt::MSG *info, const std::string &topic, const void *msg, const int szmsg,
+                    const void *cbdata) -> void { exact++; },
+              nullptr, AITT_QOS_AT_MOST_ONCE);
+        mq.Subscribe(
+              "Test/+",
+              [&](aitt::MSG *info, const std::string &topic, const void *msg, const int szmsg,
+                    const void *cbdata) -> void { wildcard++; },
+              nullptr, AITT_QOS_AT_MOST_ONCE);
+
+        // Both filters match the topic, but the broker delivers it for the second one only.
+        mosquitto_property *props = nullptr;
+        mosquitto_property_add_varint(&props, MQTT_PROP_SUBSCRIPTION_IDENTIFIER, 2);
+        struct mosquitto_message message = {};
+        message.topic = const_cast<char *>(TEST_TOPIC);
+        message.payload = const_cast<char *>(TEST_PAYLOAD);
+        message.payloadlen = sizeof(TEST_PAYLOAD);
+        message_cb(TEST_HANDLE, obj, &message, props);
+        mosquitto_property_free_all(&props);
+
+        EXPECT_EQ(exact, 0);
+        EXPECT_EQ(wildcard, 1);
+    } catch (std::exception &e) {
+        FAIL() << "Unexpected exception: " << e.what();
+    }
+}
+
+TEST_F(MQMockTest, SendReply_Legacy_Request_P_Anytime)
+{
+    void *obj = nullptr;
+    void (*message_cb)(struct mosquitto *, void *, const struct mosquitto_message *,
+          const mosquitto_property *) = nullptr;
+    std::string correlation;
+    std::string sequence;
+    std::string end_sequence;
+
+    EXPECT_CALL(GetMock(), mosquitto_lib_init()).WillOnce(Return(MOSQ_ERR_SUCCESS));
+    EXPECT_CALL(GetMock(), mosquitto_new(testing::StrEq(TEST_CLIENT_ID), true, testing::_))
+          .WillOnce(testing::DoAll(testing::SaveArg<2>(&obj), Return(TEST_HANDLE)));
+    EXPECT_CALL(GetMock(), mosquitto_message_v5_callback_set(TEST_HANDLE, testing::_))
+          .WillOnce(testing::SaveArg<1>(&message_cb));
+    EXPECT_CALL(GetMock(), mosquitto_loop_start(TEST_HANDLE)).WillOnce(Return(MOSQ_ERR_SUCCESS));
+    EXPECT_CALL(GetMock(),
+          mosquitto_connect_async(TEST_HANDLE, testing::StrEq(TEST_HOST), TEST_PORT, 60))
+          .WillOnce(Return(MOSQ_ERR_SUCCESS));
+    EXPECT_CALL(GetMock(),
+          mosquitto_subscribe(TEST_HANDLE, testing::_, testing::StrEq(TEST_TOPIC), 0))
+          .WillOnce(Return(MOSQ_ERR_SUCCESS));
+    EXPECT_CALL(GetMock(), mosquitto_publish_v5(TEST_HANDLE, testing::_,
+                                 testing::StrEq("Test/Reply"), 5, testing::_, 0, false, testing::_))
+          .WillOnce(testing::Invoke([&](struct mosquitto *mosq, int *mid, const char *topic,
+                                          int payloadlen, const void *payload, int qos,
+                                          bool retain, const mosquitto_property *props) {
+              void *data = nullptr;
+              uint16_t size = 0;
+              mosquitto_property_read_binary(props, MQTT_PROP_CORRELATION_DATA, &data, &size,
+                    false);
+              correlation.assign(static_cast<char *>(data), size);
+              free(data);
+
+              char *name = nullptr;
+              char *value = nullptr;
+              const mosquitto_property *prop = mosquitto_property_read_string_pair(props,
+                    MQTT_PROP_USER_PROPERTY, &name, &value, false);
+              while (prop) {
+                  if (std::string(name) == "sequenceNum")
+                      sequence = value;
+                  else if (std::string(name) == "isEndSequence")
+                      end_sequence = value;
+                  free(name);
+                  free(value);
+                  prop = mosquitto_property_read_string_pair(prop, MQTT_PROP_USER_PROPERTY, &name,
+                        &value, true);
+              }
+              return MOSQ_ERR_SUCCESS;
+          }));
+    EXPECT_CALL(GetMock(), mosquitto_destroy(TEST_HANDLE)).Times(1);
+    EXPECT_CALL(GetMock(), mosquitto_lib_cleanup()).WillOnce(Return(MOSQ_ERR_SUCCESS));
+
+    try {
+        // Replies with the default options, to a request without the reply header property
+        aitt::MosquittoMQ mq(TEST_CLIENT_ID, true);
+        mq.Connect(TEST_HOST, TEST_PORT, "", "");
+        ASSERT_NE(message_cb, nullptr);
+        mq.Subscribe(
+              TEST_TOPIC,
+              [&](aitt::MSG *info, const std::string &topic, const void *msg, const int szmsg,
+                    const void *cbdata) -> void {
+                  EXPECT_FALSE(info->IsReplyHeaderAccepted());
+                  info->IncreaseSequence();
+                  info->SetEndSequence(true);
+                  mq.SendReply(info, "reply", 5, AITT_QOS_AT_MOST_ONCE, false);
+              },
+              nullptr, AITT_QOS_AT_MOST_ONCE);
+
+        mosquitto_property *props = nullptr;
+        mosquitto_property_add_string(&props, MQTT_PROP_RESPONSE_TOPIC, "Test/Reply");
+        mosquitto_property_add_binary(&props, MQTT_PROP_CORRELATION_DATA, "0001", 4);
+        struct mosquitto_message message = {};
+        message.topic = const_cast<char *>(TEST_TOPIC);
+        message.payload = const_cast<char *>(TEST_PAYLOAD);
+        message.payloadlen = sizeof(TEST_PAYLOAD);
+        message_cb(TEST_HANDLE, obj, &message, props);
+        mosquitto_property_free_all(&props);
+
+        EXPECT_EQ(correlation, "0001");
+        EXPECT_EQ(sequence, "1");
+        EXPECT_EQ(end_sequence, "1");
+    } catch (std::exception &e) {
+        FAIL() << "Unexpected exception: " << e.what();
+    }
+}
+
 TEST_F(MQMockTest, Create_P_Anytime)
 {
     EXPECT_CALL(GetMock(), mosquitto_lib_init()).WillOnce(Return(MOSQ_ERR_SUCCESS));
@@ -196,7 +500,8 @@ TEST_F(MQMockTest, Connect_P_Anytime)
     EXPECT_CALL(GetMock(), mosquitto_new(testing::StrEq(TEST_CLIENT_ID), true, testing::_))
           .WillOnce(Return(TEST_HANDLE));
     EXPECT_CALL(GetMock(), mosquitto_message_v5_callback_set(TEST_HANDLE, testing::_)).Times(1);
-    EXPECT_CALL(GetMock(), mosquitto_connect(TEST_HANDLE, testing::StrEq(TEST_HOST), TEST_PORT, 60))
+    EXPECT_CALL(GetMock(),
+          mosquitto_connect_async(TEST_HANDLE, testing::StrEq(TEST_HOST), TEST_PORT, 60))
           .WillOnce(Return(MOSQ_ERR_SUCCESS));
     EXPECT_CALL(GetMock(), mosquitto_destroy(TEST_HANDLE)).Times(1);
     EXPECT_CALL(GetMock(), mosquitto_lib_cleanup()).WillOnce(Return(MOSQ_ERR_SUCCESS));
@@ -219,7 +524,8 @@ TEST_F(MQMockTest, Connect_User_P_Anytime)
     EXPECT_CALL(GetMock(),
           mosquitto_username_pw_set(TEST_HANDLE, username.c_str(), password.c_str()))
           .Times(1);
-    EXPECT_CALL(GetMock(), mosquitto_connect(TEST_HANDLE, testing::StrEq(TEST_HOST), TEST_PORT, 60))
+    EXPECT_CALL(GetMock(),
+          mosquitto_connect_async(TEST_HANDLE, testing::StrEq(TEST_HOST), TEST_PORT, 60))
           .WillOnce(Return(MOSQ_ERR_SUCCESS));
     EXPECT_CALL(GetMock(), mosquitto_destroy(TEST_HANDLE)).Times(1);
     EXPECT_CALL(GetMock(), mosquitto_lib_cleanup()).WillOnce(Return(MOSQ_ERR_SUCCESS));
@@ -231,6 +537,81 @@ TEST_F(MQMockTest, Connect_User_P_Anytime)
     }
 }
 
+TEST_F(MQMockTest, Connect_Retry_P_Anytime)
+{
+    EXPECT_CALL(GetMock(), mosquitto_lib_init()).WillOnce(Return(MOSQ_ERR_SUCCESS));
+    EXPECT_CALL(GetMock(), mosquitto_new(testing::StrEq(TEST_CLIENT_ID), true, testing::_))
+          .WillOnce(Return(TEST_HANDLE));
+    EXPECT_CALL(GetMock(), mosquitto_reconnect_delay_set(TEST_HANDLE, testing::Ge(1u),
+                                 testing::Le(32u), true))
+          .WillOnce(Return(MOSQ_ERR_SUCCESS));
+    EXPECT_CALL(GetMock(), mosquitto_loop_start(TEST_HANDLE)).WillOnce(Return(MOSQ_ERR_SUCCESS));
+    // The broker is not reachable yet
+    EXPECT_CALL(GetMock(),
+          mosquitto_connect_async(TEST_HANDLE, testing::StrEq(TEST_HOST), TEST_PORT, 60))
+          .WillOnce(Return(MOSQ_ERR_ERRNO));
+    EXPECT_CALL(GetMock(), mosquitto_destroy(TEST_HANDLE)).Times(1);
+    EXPECT_CALL(GetMock(), mosquitto_lib_cleanup()).WillOnce(Return(MOSQ_ERR_SUCCESS));
+    try {
+        aitt::MosquittoMQ mq(TEST_CLIENT_ID, true);
+        mq.Connect(TEST_HOST, TEST_PORT, "", "");
+    } catch (std::exception &e) {
+        FAIL() << "Unexpected exception: " << e.what();
+    }
+}
+
+TEST_F(MQMockTest, Connect_Restore_Subscriptions_P_Anytime)
+{
+    void *obj = nullptr;
+    void (*connect_cb)(struct mosquitto *, void *, int, int, const mosquitto_property *) = nullptr;
+
+    EXPECT_CALL(GetMock(), mosquitto_lib_init()).WillOnce(Return(MOSQ_ERR_SUCCESS));
+    EXPECT_CALL(GetMock(), mosquitto_new(testing::StrEq(TEST_CLIENT_ID), true, testing::_))
+          .WillOnce(testing::DoAll(testing::SaveArg<2>(&obj), Return(TEST_HANDLE)));
+    EXPECT_CALL(GetMock(), mosquitto_connect_v5_callback_set(TEST_HANDLE, testing::_))
+          .WillOnce(testing::SaveArg<1>(&connect_cb));
+    // Subscribed before the connection is made
+    EXPECT_CALL(GetMock(), mosquitto_subscribe(TEST_HANDLE, testing::_, testing::StrEq(TEST_TOPIC),
+                                 AITT_QOS_AT_LEAST_ONCE))
+          .WillOnce(Return(MOSQ_ERR_NO_CONN));
+    // Only once, the second CONNACK says that the session is present
+    EXPECT_CALL(GetMock(), mosquitto_subscribe_v5(TEST_HANDLE, testing::_,
+                                 testing::StrEq(TEST_TOPIC), AITT_QOS_AT_LEAST_ONCE,
+                                 MQTT_SUB_OPT_SEND_RETAIN_IF_NEW, testing::NotNull()))
+          .WillOnce(Return(MOSQ_ERR_SUCCESS));
+    // Subscribed while disconnected, which the present session does not have
+    EXPECT_CALL(GetMock(), mosquitto_subscribe_v5(TEST_HANDLE, testing::_,
+                                 testing::StrEq("Test/Deferred"), AITT_QOS_AT_MOST_ONCE, 0,
+                                 testing::NotNull()))
+          .WillOnce(Return(MOSQ_ERR_NO_CONN));
+    EXPECT_CALL(GetMock(), mosquitto_subscribe_v5(TEST_HANDLE, testing::_,
+                                 testing::StrEq("Test/Deferred"), AITT_QOS_AT_MOST_ONCE,
+                                 MQTT_SUB_OPT_SEND_RETAIN_IF_NEW, testing::NotNull()))
+          .WillOnce(Return(MOSQ_ERR_SUCCESS));
+    EXPECT_CALL(GetMock(), mosquitto_destroy(TEST_HANDLE)).Times(1);
+    EXPECT_CALL(GetMock(), mosquitto_lib_cleanup()).WillOnce(Return(MOSQ_ERR_SUCCESS));
+
+    try {
+        aitt::MosquittoMQ mq(TEST_CLIENT_ID, true);
+        mq.Subscribe(
+              TEST_TOPIC,
+              [](aitt::MSG *info, const std::string &topic, const void *msg, const int szmsg,
+                    const void *cbdata) -> void {},
+              nullptr, AITT_QOS_AT_LEAST_ONCE);
+        mq.Connect(TEST_HOST, TEST_PORT, "", "");
+        ASSERT_NE(connect_cb, nullptr);
+        connect_cb(TEST_HANDLE, obj, 0, 0, nullptr);
+        mq.Subscribe(
+              "Test/Deferred",
+              [](aitt::MSG *info, const std::string &topic, const void *msg, const int szmsg,
+                    const void *cbdata) -> void {},
+              nullptr, AITT_QOS_AT_MOST_ONCE);
+        connect_cb(TEST_HANDLE, obj, 0, 1, nullptr);
+    } catch (std::exception &e) {
+        FAIL() << "Unexpected exception: " << e.what();
+    }
+}
+
 TEST_F(MQMockTest, Disconnect_P_Anytime)
 {
     EXPECT_CALL(GetMock(), mosquitto_lib_init()).WillOnce(Return(MOSQ_ERR_SUCCESS));
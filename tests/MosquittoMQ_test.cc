@@ -15,7 +15,16 @@
  */
 #include "MosquittoMQ.h"
 
+#include <arpa/inet.h>
 #include <gtest/gtest.h>
+#include <linux/tcp.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <set>
 
 #include "AittTests.h"
 #include "aitt_internal.h"
@@ -26,6 +35,28 @@ class MQTest : public testing::Test, public AittTests {
   protected:
     void SetUp() override { Init(); }
     void TearDown() override { Deinit(); }
+
+    // Sockets of this process connected to the local broker
+    static std::set<int> BrokerSockets(void)
+    {
+        std::set<int> sockets;
+        for (int fd = 0; fd < 1024; fd++) {
+            struct sockaddr_in addr;
+            socklen_t len = sizeof(addr);
+            if (getpeername(fd, reinterpret_cast<struct sockaddr *>(&addr), &len) == 0
+                  && addr.sin_family == AF_INET && ntohs(addr.sin_port) == 1883)
+                sockets.insert(fd);
+        }
+        return sockets;
+    }
+
+    static uint64_t BytesAcked(int fd)
+    {
+        struct tcp_info info = {};
+        socklen_t len = sizeof(info);
+        getsockopt(fd, IPPROTO_TCP, TCP_INFO, &info, &len);
+        return info.tcpi_bytes_acked;
+    }
 };
 
 TEST_F(MQTest, Positve_Subscribe_in_Subscribe_Anytime)
@@ -73,3 +104,71 @@ TEST_F(MQTest, Positve_Subscribe_in_Subscribe_Anytime)
         FAIL() << "Unexpected exception: " << e.what();
     }
 }
+
+TEST_F(MQTest, TopicAlias_P_Anytime)
+{
+    const std::string topic = "/v1/custom/aitt/topic_alias/" + std::string(100, 'a');
+    const int count = 100;
+
+    std::mutex lock;
+    std::condition_variable cond;
+    int received = 0;
+    bool connected = false;
+
+    try {
+        MosquittoMQ sub_mq("MQ_TEST_SUB_ID");
+        sub_mq.Connect(LOCAL_IP, 1883, "", "");
+        sub_mq.Subscribe(topic,
+              [&](aitt::MSG *handle, const std::string &msg_topic, const void *data,
+                    const size_t datalen, void *user_data) {
+                  EXPECT_EQ(msg_topic, topic);
+                  EXPECT_EQ(std::string(static_cast<const char *>(data), datalen), TEST_MSG);
+                  std::lock_guard<std::mutex> guard(lock);
+                  received++;
+                  cond.notify_one();
+              });
+        usleep(100000);
+
+        std::set<int> sockets = BrokerSockets();
+        MosquittoMQ mq("MQ_TEST_ID");
+        mq.SetConnectionCallback([&](int status) {
+            std::lock_guard<std::mutex> guard(lock);
+            connected = (status == AITT_CONNECTED);
+            cond.notify_one();
+        });
+        mq.Connect(LOCAL_IP, 1883, "", "");
+
+        int fd = -1;
+        for (int socket : BrokerSockets()) {
+            if (sockets.count(socket) == 0)
+                fd = socket;
+        }
+        ASSERT_NE(fd, -1);
+
+        {
+            std::unique_lock<std::mutex> guard(lock);
+            ASSERT_TRUE(cond.wait_for(guard, std::chrono::seconds(5), [&]() { return connected; }));
+        }
+
+        uint64_t acked = BytesAcked(fd);
+        for (int i = 0; i < count; i++)
+            mq.Publish(topic, TEST_MSG, strlen(TEST_MSG));
+
+        {
+            std::unique_lock<std::mutex> guard(lock);
+            cond.wait_for(guard, std::chrono::seconds(5), [&]() { return received == count; });
+            EXPECT_EQ(received, count);
+        }
+        usleep(100000);
+
+        // Without aliases, every message would carry the whole topic
+        uint64_t sent = BytesAcked(fd) - acked;
+        DBG("%d messages: %llu bytes", count, static_cast<unsigned long long>(sent));
+        EXPECT_LT(sent, count * topic.size());
+
+        mq.Disconnect();
+        sub_mq.Disconnect();
+    } catch (std::exception &e) {
+        FAIL() << "Unexpected exception: " << e.what();
+    }
+}
@@ -17,6 +17,8 @@
 #include <gtest/gtest.h>
 
 #include <iostream>
+#include <string>
+#include <vector>
 
 #include "AITT.h"
 #include "AittTests.h"
@@ -54,9 +56,22 @@ class AITTRRTest : public testing::Test, public AittTests {
     }
 
   protected:
-    void SetUp() override { Init(); }
+    void SetUp() override
+    {
+        Init();
+        multiplex_reply = false;
+        legacy_reply_format = false;
+    }
     void TearDown() override { Deinit(); }
 
+    AittOption Option(void)
+    {
+        AittOption option(true, false);
+        option.SetMultiplexReply(multiplex_reply);
+        option.SetLegacyReplyFormat(legacy_reply_format);
+        return option;
+    }
+
     void CheckReply(aitt::MSG *msg, const void *data, const size_t datalen)
     {
         std::string received_data((const char *)data, datalen);
@@ -80,7 +95,7 @@ class AITTRRTest : public testing::Test, public AittTests {
         bool reply_ok[2];
         sub_ok = reply_ok[0] = reply_ok[1] = false;
 
-        AITT aitt(clientId, LOCAL_IP, AittOption(true, false));
+        AITT aitt(clientId, LOCAL_IP, Option());
         aitt.Connect();
 
         aitt.Subscribe(rr_topic.c_str(),
@@ -135,7 +150,7 @@ class AITTRRTest : public testing::Test, public AittTests {
                   sub_ok = true;
               });
 
-        AITT aitt(clientId, LOCAL_IP, AittOption(true, false));
+        AITT aitt(clientId, LOCAL_IP, Option());
         aitt.Connect();
 
         using namespace std::placeholders;
@@ -158,106 +173,118 @@ class AITTRRTest : public testing::Test, public AittTests {
         EXPECT_TRUE(reply2_ok);
     }
 
+    void RequestResponse(void)
+    {
+        bool sub_ok, reply_ok;
+        sub_ok = reply_ok = false;
+
+        try {
+            AITT aitt(clientId, LOCAL_IP, Option());
+            aitt.Connect();
+
+            aitt.Subscribe(rr_topic.c_str(),
+                  [&](aitt::MSG *msg, const void *data, const size_t datalen, void *cbdata) {
+                      CheckSubscribe(msg, data, datalen);
+                      aitt.SendReply(msg, reply.c_str(), reply.size());
+                      sub_ok = true;
+                  });
+
+            aitt.PublishWithReply(rr_topic.c_str(), message.c_str(), message.size(), AITT_TYPE_MQTT,
+                  AITT_QOS_AT_MOST_ONCE, false,
+                  std::bind(&AITTRRTest::CheckReplyCallback, GetHandle(), true, &reply_ok,
+                        std::placeholders::_1, std::placeholders::_2, std::placeholders::_3,
+                        std::placeholders::_4),
+                  nullptr, correlation);
+
+            g_timeout_add(10, AittTests::ReadyCheck, static_cast<AittTests *>(this));
+            IterateEventLoop();
+
+            EXPECT_TRUE(sub_ok);
+            EXPECT_TRUE(reply_ok);
+        } catch (std::exception &e) {
+            FAIL() << e.what();
+        }
+    }
+
+    void RequestResponseAsymmetry(void)
+    {
+        std::string reply1 = "1st data";
+        std::string reply2 = "2nd data";
+        std::string reply3 = "final data";
+
+        bool sub_ok, reply_ok;
+        sub_ok = reply_ok = false;
+
+        try {
+            AITT aitt(clientId, LOCAL_IP, Option());
+            aitt.Connect();
+
+            aitt.Subscribe(rr_topic.c_str(),
+                  [&](aitt::MSG *msg, const void *data, const size_t datalen, void *cbdata) {
+                      CheckSubscribe(msg, data, datalen);
+
+                      aitt.SendReply(msg, reply1.c_str(), reply1.size(), false);
+                      aitt.SendReply(msg, reply2.c_str(), reply2.size(), false);
+                      aitt.SendReply(msg, reply3.c_str(), reply3.size(), true);
+
+                      sub_ok = true;
+                  });
+
+            aitt.PublishWithReply(
+                  rr_topic.c_str(), message.c_str(), message.size(), AITT_TYPE_MQTT,
+                  AITT_QOS_AT_MOST_ONCE, false,
+                  [&](aitt::MSG *msg, const void *data, const size_t datalen, void *cbdata) {
+                      std::string reply((const char *)data, datalen);
+
+                      EXPECT_EQ(msg->GetCorrelation(), correlation);
+                      switch (msg->GetSequence()) {
+                      case 1:
+                          EXPECT_EQ(reply, reply1);
+                          break;
+                      case 2:
+                          EXPECT_EQ(reply, reply2);
+                          break;
+                      case 3:
+                          EXPECT_EQ(reply, reply3);
+                          EXPECT_TRUE(msg->IsEndSequence());
+                          reply_ok = true;
+                          ToggleReady();
+                          break;
+                      default:
+                          FAIL() << "Unknown sequence" << msg->GetSequence();
+                      }
+                  },
+                  nullptr, correlation);
+
+            g_timeout_add(10, AittTests::ReadyCheck, static_cast<AittTests *>(this));
+            IterateEventLoop();
+
+            EXPECT_TRUE(sub_ok);
+            EXPECT_TRUE(reply_ok);
+
+        } catch (aitt::AittException &e) {
+            FAIL() << e.what();
+        }
+    }
+
     AITTRRTest *GetHandle() { return this; }
 
     const std::string rr_topic = "test/rr_topic";
     const std::string message = "Hello world";
     const std::string correlation = "0001";
     const std::string reply = "Nice to meet you, RequestResponse";
+    bool multiplex_reply;
+    bool legacy_reply_format;
 };
 
 TEST_F(AITTRRTest, RequestResponse_P_Anytime)
 {
-    bool sub_ok, reply_ok;
-    sub_ok = reply_ok = false;
-
-    try {
-        AITT aitt(clientId, LOCAL_IP, AittOption(true, false));
-        aitt.Connect();
-
-        aitt.Subscribe(rr_topic.c_str(),
-              [&](aitt::MSG *msg, const void *data, const size_t datalen, void *cbdata) {
-                  CheckSubscribe(msg, data, datalen);
-                  aitt.SendReply(msg, reply.c_str(), reply.size());
-                  sub_ok = true;
-              });
-
-        aitt.PublishWithReply(rr_topic.c_str(), message.c_str(), message.size(), AITT_TYPE_MQTT,
-              AITT_QOS_AT_MOST_ONCE, false,
-              std::bind(&AITTRRTest::CheckReplyCallback, GetHandle(), true, &reply_ok,
-                    std::placeholders::_1, std::placeholders::_2, std::placeholders::_3,
-                    std::placeholders::_4),
-              nullptr, correlation);
-
-        g_timeout_add(10, AittTests::ReadyCheck, static_cast<AittTests *>(this));
-        IterateEventLoop();
-
-        EXPECT_TRUE(sub_ok);
-        EXPECT_TRUE(reply_ok);
-    } catch (std::exception &e) {
-        FAIL() << e.what();
-    }
+    RequestResponse();
 }
 
 TEST_F(AITTRRTest, RequestResponse_asymmetry_Anytime)
 {
-    std::string reply1 = "1st data";
-    std::string reply2 = "2nd data";
-    std::string reply3 = "final data";
-
-    bool sub_ok, reply_ok;
-    sub_ok = reply_ok = false;
-
-    try {
-        AITT aitt(clientId, LOCAL_IP, AittOption(true, false));
-        aitt.Connect();
-
-        aitt.Subscribe(rr_topic.c_str(),
-              [&](aitt::MSG *msg, const void *data, const size_t datalen, void *cbdata) {
-                  CheckSubscribe(msg, data, datalen);
-
-                  aitt.SendReply(msg, reply1.c_str(), reply1.size(), false);
-                  aitt.SendReply(msg, reply2.c_str(), reply2.size(), false);
-                  aitt.SendReply(msg, reply3.c_str(), reply3.size(), true);
-
-                  sub_ok = true;
-              });
-
-        aitt.PublishWithReply(
-              rr_topic.c_str(), message.c_str(), message.size(), AITT_TYPE_MQTT,
-              AITT_QOS_AT_MOST_ONCE, false,
-              [&](aitt::MSG *msg, const void *data, const size_t datalen, void *cbdata) {
-                  std::string reply((const char *)data, datalen);
-
-                  EXPECT_EQ(msg->GetCorrelation(), correlation);
-                  switch (msg->GetSequence()) {
-                  case 1:
-                      EXPECT_EQ(reply, reply1);
-                      break;
-                  case 2:
-                      EXPECT_EQ(reply, reply2);
-                      break;
-                  case 3:
-                      EXPECT_EQ(reply, reply3);
-                      EXPECT_TRUE(msg->IsEndSequence());
-                      reply_ok = true;
-                      ToggleReady();
-                      break;
-                  default:
-                      FAIL() << "Unknown sequence" << msg->GetSequence();
-                  }
-              },
-              nullptr, correlation);
-
-        g_timeout_add(10, AittTests::ReadyCheck, static_cast<AittTests *>(this));
-        IterateEventLoop();
-
-        EXPECT_TRUE(sub_ok);
-        EXPECT_TRUE(reply_ok);
-
-    } catch (aitt::AittException &e) {
-        FAIL() << e.what();
-    }
+    RequestResponseAsymmetry();
 }
 
 TEST_F(AITTRRTest, RequestResponse_2times_Anytime)
@@ -391,3 +418,137 @@ TEST_F(AITTRRTest, RequestResponse_timeout_restart_P_Anytime)
         FAIL() << e.what();
     }
 }
+
+TEST_F(AITTRRTest, RequestResponse_multiplex_P_Anytime)
+{
+    multiplex_reply = true;
+    RequestResponse();
+}
+
+TEST_F(AITTRRTest, RequestResponse_asymmetry_multiplex_P_Anytime)
+{
+    multiplex_reply = true;
+    RequestResponseAsymmetry();
+}
+
+TEST_F(AITTRRTest, RequestResponse_legacy_format_P_Anytime)
+{
+    legacy_reply_format = true;
+    RequestResponse();
+}
+
+TEST_F(AITTRRTest, RequestResponse_asymmetry_legacy_format_P_Anytime)
+{
+    legacy_reply_format = true;
+    RequestResponseAsymmetry();
+}
+
+TEST_F(AITTRRTest, RequestResponse_legacy_requester_P_Anytime)
+{
+    bool sub_ok, reply_ok;
+    sub_ok = reply_ok = false;
+
+    try {
+        AITT sub_aitt(clientId + "sub", LOCAL_IP, Option());
+        sub_aitt.Connect();
+        sub_aitt.Subscribe(rr_topic.c_str(),
+              [&](aitt::MSG *msg, const void *data, const size_t datalen, void *cbdata) {
+                  CheckSubscribe(msg, data, datalen);
+                  sub_aitt.SendReply(msg, reply.c_str(), reply.size());
+                  sub_ok = true;
+              });
+
+        legacy_reply_format = true;
+        AITT aitt(clientId, LOCAL_IP, Option());
+        aitt.Connect();
+        aitt.PublishWithReply(rr_topic.c_str(), message.c_str(), message.size(), AITT_TYPE_MQTT,
+              AITT_QOS_AT_MOST_ONCE, false,
+              std::bind(&AITTRRTest::CheckReplyCallback, GetHandle(), true, &reply_ok,
+                    std::placeholders::_1, std::placeholders::_2, std::placeholders::_3,
+                    std::placeholders::_4),
+              nullptr, correlation);
+
+        g_timeout_add(10, AittTests::ReadyCheck, static_cast<AittTests *>(this));
+        IterateEventLoop();
+
+        EXPECT_TRUE(sub_ok);
+        EXPECT_TRUE(reply_ok);
+    } catch (std::exception &e) {
+        FAIL() << e.what();
+    }
+}
+
+TEST_F(AITTRRTest, RequestResponse_2times_multiplex_P_Anytime)
+{
+    try {
+        multiplex_reply = true;
+        Call2Times(false, false);
+    } catch (std::exception &e) {
+        FAIL() << e.what();
+    }
+}
+
+TEST_F(AITTRRTest, RequestResponse_sync_in_async_multiplex_P_Anytime)
+{
+    try {
+        multiplex_reply = true;
+        SyncCallInCallback(false);
+    } catch (std::exception &e) {
+        FAIL() << e.what();
+    }
+}
+
+TEST_F(AITTRRTest, RequestResponse_async_future_P_Anytime)
+{
+    const int count = 20;
+
+    try {
+        AITT sub_aitt(clientId + "sub", LOCAL_IP, AittOption(true, false));
+        sub_aitt.Connect();
+        sub_aitt.Subscribe(rr_topic.c_str(),
+              [&](aitt::MSG *msg, const void *data, const size_t datalen, void *cbdata) {
+                  CheckSubscribe(msg, data, datalen);
+                  sub_aitt.SendReply(msg, reply.c_str(), reply.size(), false);
+                  sub_aitt.SendReply(msg, reply.c_str(), reply.size(), true);
+              });
+
+        AITT aitt(clientId, LOCAL_IP, AittOption(true, false));
+        aitt.Connect();
+
+        std::vector<std::future<std::vector<AITT::Reply>>> futures;
+        for (int i = 0; i < count; i++) {
+            futures.push_back(aitt.PublishWithReplyAsync(rr_topic, message.c_str(),
+                  message.size(), AITT_TYPE_MQTT, AITT_QOS_AT_MOST_ONCE, correlation, 5000));
+        }
+
+        for (auto &future : futures) {
+            std::vector<AITT::Reply> replies = future.get();
+            ASSERT_EQ(replies.size(), 2U);
+            EXPECT_EQ(replies[0].msg.GetCorrelation(), correlation);
+            EXPECT_FALSE(replies[0].msg.IsEndSequence());
+            EXPECT_TRUE(replies[1].msg.IsEndSequence());
+            EXPECT_EQ(std::string(replies[1].data.begin(), replies[1].data.end()), reply);
+        }
+    } catch (std::exception &e) {
+        FAIL() << e.what();
+    }
+}
+
+TEST_F(AITTRRTest, RequestResponse_async_future_timeout_P_Anytime)
+{
+    try {
+        AITT aitt(clientId, LOCAL_IP, AittOption(true, false));
+        aitt.Connect();
+
+        auto future = aitt.PublishWithReplyAsync(rr_topic, message.c_str(), message.size(),
+              AITT_TYPE_MQTT, AITT_QOS_AT_MOST_ONCE, correlation, 10);
+        try {
+            future.get();
+            FAIL() << "Should not be called";
+        } catch (aitt::AittException &e) {
+            EXPECT_EQ(e.getErrCode(), aitt::AittException::TIMED_OUT_ERR);
+        }
+    } catch (std::exception &e) {
+        FAIL() << e.what();
+    }
+}
@@ -0,0 +1,212 @@
+/*
+ * Copyright (c) 2022 Samsung Electronics Co., Ltd All Rights Reserved
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "ShardedMQ.h"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "AittException.h"
+
+#define TEST_SHARDS 4
+
+// Records the calls instead of talking to a broker
+class FakeMQ : public aitt::MQ {
+  public:
+    void SetConnectionCallback(const MQConnectionCallback &cb) override { connect_cb = cb; }
+    void Connect(const std::string &host, int port, const std::string &username,
+          const std::string &password) override
+    {
+    }
+    void SetWillInfo(const std::string &topic, const void *msg, size_t szmsg, int qos,
+          bool retain) override
+    {
+    }
+    void Disconnect(void) override {}
+    void Publish(const std::string &topic, const void *data, const size_t datalen, int qos = 0,
+          bool retain = false) override
+    {
+        published.push_back(topic);
+    }
+    void PublishWithReply(const std::string &topic, const void *data, const size_t datalen,
+          int qos, bool retain, const std::string &reply_topic,
+          const std::string &correlation) override
+    {
+        published.push_back(topic);
+    }
+    void SendReply(aitt::MSG *msg, const void *data, const size_t datalen, int qos,
+          bool retain) override
+    {
+    }
+    void *Subscribe(const std::string &topic, const SubscribeCallback &cb,
+          void *user_data = nullptr, int qos = 0) override
+    {
+        subscribed.push_back(topic);
+        return reinterpret_cast<void *>(subscribed.size());
+    }
+    void *Unsubscribe(void *handle) override
+    {
+        unsubscribed.push_back(subscribed[reinterpret_cast<uintptr_t>(handle) - 1]);
+        return nullptr;
+    }
+
+    MQConnectionCallback connect_cb;
+    std::vector<std::string> published;
+    std::vector<std::string> subscribed;
+    std::vector<std::string> unsubscribed;
+};
+
+class ShardedMQTest : public testing::Test {
+  protected:
+    void SetUp() override
+    {
+        std::vector<std::unique_ptr<aitt::MQ>> connections;
+        for (int i = 0; i < TEST_SHARDS; i++) {
+            shards.push_back(new FakeMQ());
+            connections.push_back(std::unique_ptr<aitt::MQ>(shards.back()));
+        }
+        mq.reset(new aitt::ShardedMQ(std::move(connections)));
+    }
+
+    // Returns the index of the connection which published or subscribed the topic
+    int FindShard(const std::string &topic, bool subscribed = false)
+    {
+        int found = -1;
+        for (int i = 0; i < TEST_SHARDS; i++) {
+            std::vector<std::string> &topics =
+                  subscribed ? shards[i]->subscribed : shards[i]->published;
+            for (const std::string &t : topics) {
+                if (t != topic)
+                    continue;
+                EXPECT_TRUE(found == -1 || found == i) << topic << " is in several connections";
+                found = i;
+            }
+        }
+        return found;
+    }
+
+    std::vector<FakeMQ *> shards;
+    std::unique_ptr<aitt::ShardedMQ> mq;
+};
+
+TEST_F(ShardedMQTest, Publish_Same_Topic_P_Anytime)
+{
+    std::vector<int> used(TEST_SHARDS, 0);
+    for (int i = 0; i < 100; i++) {
+        std::string topic = "test/topic" + std::to_string(i);
+        mq->Publish(topic, nullptr, 0);
+        mq->Publish(topic, nullptr, 0);
+
+        int shard = FindShard(topic);
+        ASSERT_GE(shard, 0);
+        used[shard]++;
+    }
+
+    for (int count : used)
+        EXPECT_GT(count, 0);
+}
+
+TEST_F(ShardedMQTest, PublishWithReply_Same_Connection_P_Anytime)
+{
+    std::hash<std::string> hash;
+    int split = 0;
+    for (int i = 0; i < 20; i++) {
+        std::string topic = "test/request" + std::to_string(i);
+        std::string reply_topic = topic + "_AittRe_" + std::to_string(i);
+        std::string reply_filter = "/v1/custom/aitt/reply/client" + std::to_string(i) + "/+";
+        if (hash(topic) % TEST_SHARDS != hash(reply_topic) % TEST_SHARDS)
+            split++;
+
+        // The reply is subscribed before the request is sent, and both must be in order
+        mq->Subscribe(reply_topic, nullptr);
+        mq->Subscribe(reply_filter, nullptr);
+        mq->PublishWithReply(topic, nullptr, 0, 0, false, reply_topic, "correlation");
+
+        int shard = FindShard(topic);
+        ASSERT_GE(shard, 0);
+        EXPECT_EQ(FindShard(reply_topic, true), shard);
+        EXPECT_EQ(FindShard(reply_filter, true), shard);
+    }
+    EXPECT_GT(split, 0) << "The topics should hash to different connections";
+}
+
+TEST_F(ShardedMQTest, Subscribe_Reply_Like_Topic_P_Anytime)
+{
+    std::hash<std::string> hash;
+    for (int i = 0; i < 20; i++) {
+        // Not a reply topic, which ends with a number after the postfix
+        std::string topic = "test/topic_AittRe_" + std::to_string(i) + "/data";
+        mq->Subscribe(topic, nullptr);
+        EXPECT_EQ(FindShard(topic, true), static_cast<int>(hash(topic) % TEST_SHARDS));
+    }
+}
+
+TEST_F(ShardedMQTest, PublishBatch_P_Anytime)
+{
+    std::vector<std::string> topics;
+    std::vector<AittPublishEntry> entries;
+    for (int i = 0; i < 20; i++)
+        topics.push_back("test/batch" + std::to_string(i % 5));
+    for (const std::string &topic : topics)
+        entries.push_back({topic.c_str(), nullptr, 0, AITT_QOS_AT_MOST_ONCE});
+
+    mq->PublishBatch(entries);
+
+    size_t total = 0;
+    for (FakeMQ *shard : shards)
+        total += shard->published.size();
+    EXPECT_EQ(total, topics.size());
+    for (int i = 0; i < 5; i++)
+        EXPECT_GE(FindShard("test/batch" + std::to_string(i)), 0);
+}
+
+TEST_F(ShardedMQTest, Subscribe_Unsubscribe_P_Anytime)
+{
+    void *first = mq->Subscribe("test/+/first", nullptr);
+    void *second = mq->Subscribe("test/second", nullptr);
+
+    int first_shard = FindShard("test/+/first", true);
+    int second_shard = FindShard("test/second", true);
+    ASSERT_GE(first_shard, 0);
+    ASSERT_GE(second_shard, 0);
+
+    mq->Unsubscribe(second);
+    mq->Unsubscribe(first);
+    ASSERT_EQ(shards[first_shard]->unsubscribed.back(), "test/+/first");
+    EXPECT_NE(std::find(shards[second_shard]->unsubscribed.begin(),
+                    shards[second_shard]->unsubscribed.end(), "test/second"),
+          shards[second_shard]->unsubscribed.end());
+
+    EXPECT_THROW(mq->Unsubscribe(first), aitt::AittException);
+}
+
+TEST_F(ShardedMQTest, ConnectionCallback_P_Anytime)
+{
+    std::vector<int> states;
+    mq->SetConnectionCallback([&](int status) { states.push_back(status); });
+
+    for (int i = 0; i < TEST_SHARDS; i++)
+        shards[i]->connect_cb(AITT_CONNECTED);
+    shards[1]->connect_cb(AITT_DISCONNECTED);
+    shards[2]->connect_cb(AITT_DISCONNECTED);
+    shards[1]->connect_cb(AITT_CONNECTED);
+    shards[2]->connect_cb(AITT_CONNECTED);
+
+    EXPECT_EQ(states, std::vector<int>({AITT_CONNECTED, AITT_DISCONNECTED, AITT_CONNECTED}));
+}
@@ -0,0 +1,95 @@
+/*
+ * Copyright (c) 2022 Samsung Electronics Co., Ltd All Rights Reserved
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "SlotMap.h"
+
+#include <gtest/gtest.h>
+
+#include <string>
+
+using SlotMap = aitt::SlotMap<std::string>;
+
+TEST(SlotMapTest, Insert_Get_P_Anytime)
+{
+    SlotMap map;
+    SlotMap::Handle a = map.Insert("a");
+    SlotMap::Handle b = map.Insert("b");
+
+    EXPECT_NE(a, 0u);
+    EXPECT_NE(a, b);
+    ASSERT_NE(map.Get(a), nullptr);
+    EXPECT_EQ(*map.Get(a), "a");
+    EXPECT_EQ(*map.Get(b), "b");
+    EXPECT_EQ(map.Size(), 2u);
+}
+
+TEST(SlotMapTest, Erase_P_Anytime)
+{
+    SlotMap map;
+    SlotMap::Handle a = map.Insert("a");
+    SlotMap::Handle b = map.Insert("b");
+
+    std::string value;
+    EXPECT_TRUE(map.Erase(a, &value));
+    EXPECT_EQ(value, "a");
+    EXPECT_EQ(map.Get(a), nullptr);
+    EXPECT_EQ(*map.Get(b), "b");
+    EXPECT_EQ(map.Size(), 1u);
+}
+
+TEST(SlotMapTest, Stale_Handle_N_Anytime)
+{
+    SlotMap map;
+    SlotMap::Handle a = map.Insert("a");
+    ASSERT_TRUE(map.Erase(a));
+
+    // The slot is reused, but the old handle must not reach the new value
+    SlotMap::Handle c = map.Insert("c");
+    EXPECT_NE(a, c);
+    EXPECT_EQ(map.Get(a), nullptr);
+    EXPECT_FALSE(map.Erase(a));
+    EXPECT_EQ(*map.Get(c), "c");
+}
+
+TEST(SlotMapTest, Invalid_Handle_N_Anytime)
+{
+    SlotMap map;
+    SlotMap::Handle a = map.Insert("a");
+
+    EXPECT_EQ(map.Get(0), nullptr);
+    EXPECT_EQ(map.Get(a + 1), nullptr);
+    EXPECT_EQ(map.Get(reinterpret_cast<SlotMap::Handle>(&map)), nullptr);
+    EXPECT_FALSE(map.Erase(0));
+    EXPECT_EQ(map.Size(), 1u);
+}
+
+TEST(SlotMapTest, Clear_P_Anytime)
+{
+    SlotMap map;
+    SlotMap::Handle a = map.Insert("a");
+    map.Insert("b");
+
+    int visited = 0;
+    map.ForEach([&](std::string &value) { visited++; });
+    EXPECT_EQ(visited, 2);
+
+    map.Clear();
+    EXPECT_EQ(map.Size(), 0u);
+    EXPECT_EQ(map.Get(a), nullptr);
+
+    visited = 0;
+    map.ForEach([&](std::string &value) { visited++; });
+    EXPECT_EQ(visited, 0);
+}
@@ -0,0 +1,134 @@
+/*
+ * Copyright (c) 2022 Samsung Electronics Co., Ltd All Rights Reserved
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "TimerWheel.h"
+
+#include <gtest/gtest.h>
+
+#include <random>
+#include <vector>
+
+// Values are the ticks the timers expire at, or indexes of them in ticks
+using TimerWheel = aitt::TimerWheel<uint64_t>;
+
+// Calls Expire() only at the ticks given by NextTick(), as a main loop would, and checks that
+// every timer expires exactly at its tick
+static size_t RunUntil(TimerWheel &wheel, uint64_t end,
+      const std::vector<uint64_t> *ticks = nullptr)
+{
+    size_t count = 0;
+    std::vector<uint64_t> expired;
+    for (uint64_t tick = wheel.NextTick(); tick <= end; tick = wheel.NextTick()) {
+        expired.clear();
+        wheel.Expire(tick, expired);
+        for (uint64_t value : expired)
+            EXPECT_EQ(ticks ? ticks->at(value) : value, tick);
+        count += expired.size();
+    }
+    return count;
+}
+
+TEST(TimerWheelTest, Expire_P_Anytime)
+{
+    TimerWheel wheel(100);
+    std::vector<uint64_t> ticks = {100, 101, 163, 164, 228, 4196, 300000, 20000000, 100000000};
+    for (uint64_t tick : ticks)
+        wheel.Add(tick, tick);
+
+    EXPECT_EQ(RunUntil(wheel, 1000000), 7u);
+    EXPECT_EQ(wheel.Size(), 2u);
+    EXPECT_EQ(RunUntil(wheel, TimerWheel::NEVER - 1), 2u);
+    EXPECT_EQ(wheel.NextTick(), TimerWheel::NEVER);
+}
+
+TEST(TimerWheelTest, Expire_Late_P_Anytime)
+{
+    TimerWheel wheel;
+    wheel.Add(10, 10);
+    wheel.Add(5000, 5000);
+
+    // Expire() is called after both, and the past one is placed to expire right away
+    std::vector<uint64_t> expired;
+    wheel.Expire(6000, expired);
+    wheel.Add(3000, 3000);
+    wheel.Expire(6001, expired);
+    EXPECT_EQ(expired, std::vector<uint64_t>({10, 5000, 3000}));
+}
+
+TEST(TimerWheelTest, Rearm_P_Anytime)
+{
+    TimerWheel wheel;
+    TimerWheel::Handle first = wheel.Add(50, 80);
+    TimerWheel::Handle second = wheel.Add(90, 90);
+
+    std::vector<uint64_t> expired;
+    wheel.Expire(40, expired);
+    EXPECT_TRUE(wheel.Rearm(first, 80));
+    EXPECT_TRUE(wheel.Rearm(second, 10000));
+    wheel.Expire(100, expired);
+    EXPECT_EQ(expired, std::vector<uint64_t>({80}));
+
+    EXPECT_FALSE(wheel.Rearm(first, 200));
+    EXPECT_TRUE(wheel.Rearm(second, 150));
+    wheel.Expire(150, expired);
+    EXPECT_EQ(expired, std::vector<uint64_t>({80, 90}));
+}
+
+TEST(TimerWheelTest, Remove_P_Anytime)
+{
+    TimerWheel wheel;
+    TimerWheel::Handle first = wheel.Add(10, 10);
+    TimerWheel::Handle second = wheel.Add(10, 11);
+    TimerWheel::Handle third = wheel.Add(100000, 100000);
+
+    uint64_t value = 0;
+    EXPECT_TRUE(wheel.Remove(second, &value));
+    EXPECT_EQ(value, 11u);
+    EXPECT_TRUE(wheel.Remove(third));
+
+    std::vector<uint64_t> expired;
+    wheel.Expire(200000, expired);
+    EXPECT_EQ(expired, std::vector<uint64_t>({10}));
+    EXPECT_EQ(wheel.NextTick(), TimerWheel::NEVER);
+
+    EXPECT_FALSE(wheel.Remove(first));
+    EXPECT_FALSE(wheel.Remove(0));
+}
+
+TEST(TimerWheelTest, Random_P_Anytime)
+{
+    std::mt19937_64 random(7);
+    std::uniform_int_distribution<uint64_t> distance(0, 1 << 26);
+    TimerWheel wheel(1000);
+    std::vector<TimerWheel::Handle> handles;
+    std::vector<uint64_t> ticks;
+    for (int i = 0; i < 2000; i++) {
+        ticks.push_back(1000 + distance(random));
+        handles.push_back(wheel.Add(ticks[i], i));
+    }
+
+    // A quarter of them are moved, and another quarter removed
+    for (size_t i = 0; i < handles.size(); i += 2) {
+        if (i % 4) {
+            ticks[i] = 1000 + distance(random);
+            EXPECT_TRUE(wheel.Rearm(handles[i], ticks[i]));
+        } else {
+            EXPECT_TRUE(wheel.Remove(handles[i]));
+        }
+    }
+
+    EXPECT_EQ(RunUntil(wheel, TimerWheel::NEVER - 1, &ticks), 1500u);
+    EXPECT_EQ(wheel.Size(), 0u);
+}
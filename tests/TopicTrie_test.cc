@@ -0,0 +1,112 @@
+/*
+ * Copyright (c) 2022 Samsung Electronics Co., Ltd All Rights Reserved
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "TopicTrie.h"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+
+using TopicTrie = aitt::TopicTrie<int>;
+
+static std::vector<int> MatchSorted(const TopicTrie &trie, const std::string &topic)
+{
+    std::vector<int> result;
+    trie.Match(topic, result);
+    std::sort(result.begin(), result.end());
+    return result;
+}
+
+TEST(TopicTrieTest, Exact_Match_P_Anytime)
+{
+    TopicTrie trie;
+    trie.Insert("a/b/c", 1);
+    trie.Insert("a/b", 2);
+    trie.Insert("a/b/c", 3);
+
+    EXPECT_EQ(MatchSorted(trie, "a/b/c"), std::vector<int>({1, 3}));
+    EXPECT_EQ(MatchSorted(trie, "a/b"), std::vector<int>({2}));
+    EXPECT_TRUE(MatchSorted(trie, "a").empty());
+    EXPECT_TRUE(MatchSorted(trie, "a/b/c/d").empty());
+    EXPECT_TRUE(MatchSorted(trie, "a/b/").empty());
+}
+
+TEST(TopicTrieTest, Single_Level_Wildcard_P_Anytime)
+{
+    TopicTrie trie;
+    trie.Insert("a/+/c", 1);
+    trie.Insert("+/+", 2);
+    trie.Insert("+", 3);
+
+    EXPECT_EQ(MatchSorted(trie, "a/b/c"), std::vector<int>({1}));
+    EXPECT_EQ(MatchSorted(trie, "a//c"), std::vector<int>({1}));
+    EXPECT_EQ(MatchSorted(trie, "a/b"), std::vector<int>({2}));
+    EXPECT_EQ(MatchSorted(trie, "/b"), std::vector<int>({2}));
+    EXPECT_EQ(MatchSorted(trie, "a"), std::vector<int>({3}));
+    EXPECT_TRUE(MatchSorted(trie, "a/b/c/d").empty());
+}
+
+TEST(TopicTrieTest, Multi_Level_Wildcard_P_Anytime)
+{
+    TopicTrie trie;
+    trie.Insert("a/#", 1);
+    trie.Insert("#", 2);
+    trie.Insert("a/+/#", 3);
+
+    EXPECT_EQ(MatchSorted(trie, "a"), std::vector<int>({1, 2}));
+    EXPECT_EQ(MatchSorted(trie, "a/b"), std::vector<int>({1, 2, 3}));
+    EXPECT_EQ(MatchSorted(trie, "a/b/c/d"), std::vector<int>({1, 2, 3}));
+    EXPECT_EQ(MatchSorted(trie, "b/c"), std::vector<int>({2}));
+}
+
+TEST(TopicTrieTest, System_Topic_P_Anytime)
+{
+    TopicTrie trie;
+    trie.Insert("#", 1);
+    trie.Insert("+/info", 2);
+    trie.Insert("$SYS/#", 3);
+    trie.Insert("$SYS/+", 4);
+
+    EXPECT_EQ(MatchSorted(trie, "$SYS/info"), std::vector<int>({3, 4}));
+    EXPECT_EQ(MatchSorted(trie, "a/$SYS"), std::vector<int>({1}));
+}
+
+TEST(TopicTrieTest, Remove_P_Anytime)
+{
+    TopicTrie trie;
+    trie.Insert("a/+/c", 1);
+    trie.Insert("a/+/c", 2);
+    trie.Insert("a/#", 3);
+
+    EXPECT_TRUE(trie.Remove("a/+/c", 1));
+    EXPECT_EQ(MatchSorted(trie, "a/b/c"), std::vector<int>({2, 3}));
+
+    EXPECT_TRUE(trie.Remove("a/+/c", 2));
+    EXPECT_TRUE(trie.Remove("a/#", 3));
+    EXPECT_TRUE(MatchSorted(trie, "a/b/c").empty());
+    EXPECT_TRUE(trie.Empty());
+}
+
+TEST(TopicTrieTest, Remove_N_Anytime)
+{
+    TopicTrie trie;
+    trie.Insert("a/b", 1);
+
+    EXPECT_FALSE(trie.Remove("a/b", 2));
+    EXPECT_FALSE(trie.Remove("a/+", 1));
+    EXPECT_FALSE(trie.Remove("a/b/c", 1));
+    EXPECT_FALSE(trie.Remove("a", 1));
+    EXPECT_EQ(MatchSorted(trie, "a/b"), std::vector<int>({1}));
+}
@@ -250,6 +250,62 @@ TEST(AITT_C_INTERFACE, pub_N_Anytime)
     aitt_destroy(handle);
 }
 
+TEST(AITT_C_INTERFACE, pub_batch_P_Anytime)
+{
+    int ret;
+
+    aitt_option_h option = aitt_option_new();
+    ASSERT_NE(option, nullptr);
+
+    ret = aitt_option_set(option, AITT_OPT_MY_IP, LOCAL_IP);
+    EXPECT_EQ(ret, AITT_ERROR_NONE);
+
+    aitt_h handle = aitt_new("test_batch", option);
+    aitt_option_destroy(option);
+    ASSERT_NE(handle, nullptr);
+
+    aitt_publish_entry_s entries[] = {
+          {TEST_C_TOPIC, TEST_C_MSG, strlen(TEST_C_MSG), AITT_QOS_AT_MOST_ONCE},
+          {TEST_C_TOPIC, TEST_C_MSG, strlen(TEST_C_MSG), AITT_QOS_AT_MOST_ONCE},
+    };
+    ret = aitt_publish_batch(handle, entries, 2, AITT_TYPE_MQTT);
+    EXPECT_EQ(ret, AITT_ERROR_NOT_READY);
+
+    ret = aitt_connect(handle, LOCAL_IP, 1883);
+    ASSERT_EQ(ret, AITT_ERROR_NONE);
+
+    GMainLoop *loop = g_main_loop_new(nullptr, FALSE);
+    int count = 0;
+    std::pair<GMainLoop *, int *> cb_data(loop, &count);
+    aitt_sub_h sub_handle = nullptr;
+    ret = aitt_subscribe(
+          handle, TEST_C_TOPIC,
+          [](aitt_msg_h msg_handle, const void *msg, size_t msg_len, void *user_data) {
+              auto cb_data = static_cast<std::pair<GMainLoop *, int *> *>(user_data);
+              std::string received_data((const char *)msg, msg_len);
+              EXPECT_STREQ(received_data.c_str(), TEST_C_MSG);
+              if (++(*cb_data->second) == 2)
+                  g_main_loop_quit(cb_data->first);
+          },
+          &cb_data, &sub_handle);
+    ASSERT_EQ(ret, AITT_ERROR_NONE);
+
+    ret = aitt_publish_batch(handle, nullptr, 2, AITT_TYPE_MQTT);
+    EXPECT_EQ(ret, AITT_ERROR_INVALID_PARAMETER);
+
+    ret = aitt_publish_batch(handle, entries, 2, AITT_TYPE_MQTT);
+    ASSERT_EQ(ret, AITT_ERROR_NONE);
+
+    g_main_loop_run(loop);
+    g_main_loop_unref(loop);
+    EXPECT_EQ(count, 2);
+
+    ret = aitt_disconnect(handle);
+    EXPECT_EQ(ret, AITT_ERROR_NONE);
+
+    aitt_destroy(handle);
+}
+
 TEST(AITT_C_INTERFACE, sub_N_Anytime)
 {
     int ret;